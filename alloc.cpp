@@ -0,0 +1,239 @@
+//////////////////////////////////
+// File alloc.cpp               //
+// Bitmap alokasi blok          //
+//////////////////////////////////
+
+#include "poi.hpp"
+
+/* jumlah bit dalam satu word bitmap */
+#define WORD_BITS 64
+
+/**
+ * Konstruktor
+ */
+Allocator::Allocator() {
+	total = 0;
+	freeBlocks = 0;
+	rover = 1;
+	lowest = 1;
+}
+
+/**
+ * Membangun bitmap dari allocation table
+ * @param table isi allocation table
+ * @param count jumlah blok volume
+ */
+void Allocator::load(const Block *table, Block count) {
+	total = count;
+	bitmap.assign((count + WORD_BITS - 1) / WORD_BITS, 0);
+	freeBlocks = 0;
+	for (Block i = 0; i < count; i++) {
+		if (table[i] != EMPTY_BLOCK) {
+			bitmap[i / WORD_BITS] |= 1ULL << (i % WORD_BITS);
+		}
+		else {
+			freeBlocks++;
+		}
+	}
+
+	/* blok 0 (root) dan blok bernomor END_BLOCK tidak pernah dialokasikan */
+	Block reserved[2] = {0, END_BLOCK};
+	for (int i = 0; i < 2; i++) {
+		if (reserved[i] < total && isFree(reserved[i])) {
+			mark(reserved[i], true);
+			freeBlocks--;
+		}
+	}
+
+	lowest = findFree(0, total);
+	rover = lowest;
+}
+
+/**
+ * Mengambil satu blok bebas, diutamakan blok hint
+ * @param  hint blok yang diinginkan, END_BLOCK jika tidak ada
+ * @return      END_BLOCK jika volume penuh
+ */
+Block Allocator::allocate(Block hint) {
+	int length = 1;
+	return allocateRun(length, hint);
+}
+
+/**
+ * Mengambil sederet blok bebas yang berurutan. Deret mulai dari hint
+ * dipakai jika cukup panjang, jika tidak dicari deret pertama sepanjang
+ * length mulai dari rover; jika tidak ada, dipakai deret terpanjang.
+ * @param  length jumlah blok yang diinginkan, diisi jumlah yang didapat
+ * @param  hint   blok awal yang diinginkan, END_BLOCK jika tidak ada
+ * @return        blok pertama, END_BLOCK jika volume penuh
+ */
+Block Allocator::allocateRun(int &length, Block hint) {
+	if (freeBlocks == 0 || length <= 0) {
+		length = 0;
+		return END_BLOCK;
+	}
+
+	Block best = END_BLOCK;
+	int bestLength = 0;
+
+	if (hint < total && isFree(hint)) {
+		best = hint;
+		bestLength = runLength(hint, length);
+	}
+
+	/* dua putaran: [rover, total) lalu [lowest, rover) */
+	Block from[2] = {rover, lowest};
+	Block to[2] = {total, rover};
+	for (int pass = 0; pass < 2 && bestLength < length; pass++) {
+		Block position = findFree(from[pass], to[pass]);
+		while (position < to[pass]) {
+			int run = runLength(position, length);
+			if (run > bestLength) {
+				best = position;
+				bestLength = run;
+				if (run == length) {
+					break;
+				}
+			}
+			position = findFree(position + run, to[pass]);
+		}
+	}
+
+	for (int i = 0; i < bestLength; i++) {
+		mark(best + i, true);
+	}
+	freeBlocks -= bestLength;
+	rover = best + bestLength;
+	if (rover >= total) {
+		rover = lowest;
+	}
+	if (best == lowest) {
+		lowest = findFree(best + bestLength, total);
+	}
+
+	length = bestLength;
+	return best;
+}
+
+/**
+ * Menandai satu blok bebas
+ * @param position blok
+ */
+void Allocator::release(Block position) {
+	releaseRun(position, 1);
+}
+
+/**
+ * Menandai sederet blok bebas
+ * @param start  blok pertama
+ * @param length jumlah blok
+ */
+void Allocator::releaseRun(Block start, int length) {
+	for (int i = 0; i < length; i++) {
+		if (!isFree(start + i)) {
+			mark(start + i, false);
+			freeBlocks++;
+		}
+	}
+	if (start < lowest) {
+		lowest = start;
+	}
+}
+
+/**
+ * Apakah blok bebas
+ */
+bool Allocator::isFree(Block position) {
+	return !(bitmap[position / WORD_BITS] & (1ULL << (position % WORD_BITS)));
+}
+
+/**
+ * Panjang deret blok bebas terpanjang, berhenti jika sudah max
+ * @param  max panjang yang dibutuhkan
+ * @return     paling banyak max
+ */
+int Allocator::longestRun(int max) {
+	int result = 0;
+	Block position = findFree(lowest, total);
+	while (position < total && result < max) {
+		int run = runLength(position, max);
+		result = run > result ? run : result;
+		position = findFree(position + run, total);
+	}
+	return result;
+}
+
+/**
+ * Jumlah blok bebas
+ */
+Block Allocator::count() {
+	return freeBlocks;
+}
+
+/**
+ * Blok bebas pertama, END_BLOCK jika volume penuh
+ */
+Block Allocator::first() {
+	return lowest < total ? lowest : END_BLOCK;
+}
+
+/**
+ * Mengubah bit sebuah blok
+ */
+void Allocator::mark(Block position, bool used) {
+	if (used) {
+		bitmap[position / WORD_BITS] |= 1ULL << (position % WORD_BITS);
+	}
+	else {
+		bitmap[position / WORD_BITS] &= ~(1ULL << (position % WORD_BITS));
+	}
+}
+
+/**
+ * Mencari blok bebas pertama pada [from, to), word yang penuh dilewati
+ * @return to jika tidak ada
+ */
+Block Allocator::findFree(Block from, Block to) {
+	Block word = from / WORD_BITS;
+	Block last = ((unsigned long long)to + WORD_BITS - 1) / WORD_BITS;
+	if (word >= last) {
+		return to;
+	}
+
+	/* bit di bawah from dianggap terpakai */
+	unsigned long long bits = ~bitmap[word] & (~0ULL << (from % WORD_BITS));
+	while (bits == 0) {
+		if (++word >= last) {
+			return to;
+		}
+		bits = ~bitmap[word];
+	}
+
+	Block result = word * WORD_BITS + __builtin_ctzll(bits);
+	return result < to ? result : to;
+}
+
+/**
+ * Panjang deret blok bebas mulai dari start, paling banyak max
+ */
+int Allocator::runLength(Block start, int max) {
+	int length = 0;
+	Block position = start;
+	while (length < max && position < total) {
+		unsigned long long used = bitmap[position / WORD_BITS] >> (position % WORD_BITS);
+		int remaining = WORD_BITS - position % WORD_BITS;
+		if (used == 0) {
+			length += remaining;
+			position += remaining;
+		}
+		else {
+			length += __builtin_ctzll(used);
+			break;
+		}
+	}
+	/* bit setelah blok terakhir di word terakhir selalu 0 */
+	if ((Block)length > total - start) {
+		length = total - start;
+	}
+	return length < max ? length : max;
+}
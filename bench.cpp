@@ -0,0 +1,1510 @@
+//////////////////////////////
+// Benchmark Poi-FS         //
+//////////////////////////////
+
+#include <algorithm>
+#include <iostream>
+#include <new>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "mount_poi.hpp"
+#include "poi.hpp"
+
+using namespace std;
+
+POI filesystem;
+
+/**
+ * Waktu sekarang dalam detik
+ */
+static double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Membuat volume baru dan memuatnya
+ * @param image nama file volume
+ * @param flags   fitur volume
+ * @param version versi format
+ */
+static void freshVolume(const char *image, int flags, int version = VOLUME_VERSION_FAT) {
+	filesystem.~POI();
+	new (&filesystem) POI();
+	filesystem.create(image, flags, version);
+	filesystem.load(image);
+}
+
+/**
+ * Membuat lalu stat n file di satu direktori
+ * @param image  nama file volume
+ * @param n      jumlah file
+ * @param hashed format direktori
+ */
+static void benchLargeDirectory(const char *image, int n, bool hashed) {
+	freshVolume(image, hashed ? VOLUME_HASHED_DIRS : 0);
+
+	/* lookup harus membaca direktori, bukan dentry cache */
+	filesystem.dentry.setCapacity(0);
+	poi_mkdir("/dir", 0777);
+
+	/* setiap file memakai satu blok data */
+	if (n > (int)filesystem.available - 1024) {
+		n = filesystem.available - 1024;
+	}
+
+	char path[64];
+	double start = now();
+	for (int i = 0; i < n; i++) {
+		sprintf(path, "/dir/f%06d", i);
+		poi_mknod(path, S_IFREG | 0666, 0);
+	}
+	double created = now();
+
+	struct stat stbuf;
+	int found = 0;
+	for (int i = 0; i < n; i++) {
+		sprintf(path, "/dir/f%06d", i);
+		found += poi_getattr(path, &stbuf) == 0;
+	}
+	double statted = now();
+
+	printf("largedir format=%s files=%d found=%d create_s=%.3f stat_s=%.3f create_us=%.1f stat_us=%.1f\n",
+		hashed ? "hashed" : "linear", n, found, created - start, statted - created,
+		(created - start) * 1e6 / n, (statted - created) * 1e6 / n);
+}
+
+/* satu halaman readdir sebesar buffer fuse (4 KB) */
+struct ReaddirPage {
+	size_t used;
+	off_t last;
+	vector<string> names;
+};
+
+/* filler readdir dengan ukuran dirent fuse, 1 jika halaman penuh */
+static int fillPage(void *buf, const char *name, const struct stat *stbuf, off_t offset) {
+	ReaddirPage *page = (ReaddirPage*)buf;
+	size_t size = (24 + strlen(name) + 7) & ~(size_t)7;
+	if (page->used + size > 4096) {
+		return 1;
+	}
+	page->used += size;
+	page->last = offset;
+	page->names.push_back(name);
+	return 0;
+}
+
+/**
+ * ls -l pada satu direktori berisi n file: readdir per halaman 4 KB
+ * dengan offset lalu getattr setiap nama. Tanpa prefill, dentry cache
+ * dikosongkan setelah setiap halaman sehingga getattr harus mencari
+ * nama di direktori seperti sebelum readdir mengisi atribut.
+ * @param image   nama file volume
+ * @param n       jumlah file
+ * @param hashed  format direktori
+ * @param prefill readdir mengisi dentry cache
+ */
+static void benchListLong(const char *image, int n, bool hashed, bool prefill) {
+	freshVolume(image, hashed ? VOLUME_HASHED_DIRS : 0);
+	poi_mkdir("/dir", 0777);
+	if (n > (int)filesystem.available - 1024) {
+		n = filesystem.available - 1024;
+	}
+
+	char path[64];
+	for (int i = 0; i < n; i++) {
+		sprintf(path, "/dir/f%06d", i);
+		poi_mknod(path, S_IFREG | 0666, 0);
+	}
+	filesystem.dentry.clear();
+	unsigned long misses = filesystem.dentry.misses;
+
+	struct stat stbuf;
+	int pages = 0;
+	int listed = 0;
+	off_t offset = 0;
+	double start = now();
+	double readdirTime = 0;
+	while (true) {
+		ReaddirPage page;
+		page.used = 0;
+		page.last = offset;
+		double begin = now();
+		poi_readdir("/dir", &page, fillPage, offset, NULL);
+		readdirTime += now() - begin;
+		if (page.names.empty()) {
+			break;
+		}
+		if (!prefill) {
+			filesystem.dentry.clear();
+		}
+		pages++;
+		offset = page.last;
+		for (size_t i = 0; i < page.names.size(); i++) {
+			if (page.names[i] == "." || page.names[i] == "..") {
+				continue;
+			}
+			string name = "/dir/" + page.names[i];
+			poi_getattr(name.c_str(), &stbuf);
+			listed++;
+		}
+	}
+	double elapsed = now() - start;
+
+	printf("lsl format=%s prefill=%s files=%d listed=%d pages=%d dentry_misses=%lu readdir_s=%.3f getattr_s=%.3f total_s=%.3f per_entry_us=%.1f\n",
+		hashed ? "hashed" : "linear", prefill ? "on" : "off", n, listed, pages,
+		filesystem.dentry.misses - misses, readdirTime, elapsed - readdirTime, elapsed, elapsed * 1e6 / max(listed, 1));
+}
+
+/**
+ * Model dcache dan cache atribut kernel fuse: lookup setiap komponen
+ * path yang entry-nya kedaluwarsa (lookup fuse memanggil getattr dan
+ * membawa atribut), lalu getattr jika atribut kedaluwarsa
+ */
+struct KernelModel {
+	double timeout;
+	unordered_map<string, double> entries;	// path -> entry berlaku sampai
+	unordered_map<string, double> attrs;	// path -> atribut berlaku sampai
+
+	int stat(const string &path, struct stat *stbuf) {
+		double t = now();
+		for (size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1)) {
+			string component = path.substr(0, slash);
+			if (entries[component] <= t) {
+				int result = poi_getattr(component.c_str(), stbuf);
+				if (result != 0) {
+					return result;
+				}
+				entries[component] = t + timeout;
+				attrs[component] = t + timeout;
+			}
+			if (slash == string::npos) {
+				break;
+			}
+		}
+		if (attrs[path] <= t) {
+			attrs[path] = t + timeout;
+			return poi_getattr(path.c_str(), stbuf);
+		}
+		return 0;
+	}
+
+	/* kernel membuang atribut sendiri setelah write */
+	void write(const string &path) {
+		attrs.erase(path);
+	}
+};
+
+/**
+ * Jumlah getattr per stat dengan timeout cache kernel tertentu; satu
+ * dari sepuluh operasi menulis file sehingga atributnya diinvalidasi
+ * @param image   nama file volume
+ * @param timeout timeout entry/atribut dalam detik
+ * @param n       jumlah stat
+ */
+static void benchKernelCache(const char *image, int timeout, int n) {
+	freshVolume(image, VOLUME_HASHED_DIRS);
+	int directories = 16;
+	int files = 64;
+	char path[64];
+	poi_mkdir("/k", 0777);
+	for (int i = 0; i < directories; i++) {
+		sprintf(path, "/k/d%02d", i);
+		poi_mkdir(path, 0777);
+		for (int j = 0; j < files; j++) {
+			sprintf(path, "/k/d%02d/f%02d", i, j);
+			poi_mknod(path, S_IFREG | 0666, 0);
+		}
+	}
+
+	KernelModel kernel;
+	kernel.timeout = timeout;
+	struct stat stbuf;
+	char data[64] = "kernel cache";
+	unsigned long getattrs = filesystem.stats.ops[OP_GETATTR].count;
+	srand(11);
+	double start = now();
+	for (int i = 0; i < n; i++) {
+		sprintf(path, "/k/d%02d/f%02d", rand() % directories, rand() % files);
+		if (i % 10 == 9) {
+			poi_write(path, data, sizeof(data), 0, NULL);
+			kernel.write(path);
+		}
+		kernel.stat(path, &stbuf);
+	}
+	double elapsed = now() - start;
+	getattrs = filesystem.stats.ops[OP_GETATTR].count - getattrs;
+
+	printf("kcache timeout=%d stats=%d getattr=%lu getattr_per_stat=%.3f stat_us=%.2f\n",
+		timeout, n, getattrs, (double)getattrs / n, elapsed * 1e6 / n);
+}
+
+/**
+ * Baca acak 4 KB pada satu file besar
+ * @param image   nama file volume
+ * @param mb      ukuran file yang diminta dalam MB
+ * @param reads   jumlah pembacaan
+ * @param version versi format
+ */
+static void benchRandomRead(const char *image, int mb, int reads, int version) {
+	freshVolume(image, 0, version);
+
+	/* ukuran file dibatasi kapasitas volume */
+	long long size = (long long)mb * 1024 * 1024;
+	long long limit = (long long)(filesystem.available - 1024) * filesystem.blockSize;
+	if (size > limit) {
+		size = limit;
+	}
+	size -= size % 4096;
+
+	struct fuse_file_info fi;
+	memset(&fi, 0, sizeof(fi));
+	poi_mknod("/big", S_IFREG | 0666, 0);
+	poi_open("/big", &fi);
+
+	char buffer[4096];
+	memset(buffer, 'x', sizeof(buffer));
+	double start = now();
+	for (long long offset = 0; offset < size; offset += sizeof(buffer)) {
+		poi_write("/big", buffer, sizeof(buffer), offset, &fi);
+	}
+	double written = now();
+
+	srand(1);
+	long long chunks = size / sizeof(buffer);
+	for (int i = 0; i < reads; i++) {
+		off_t offset = (off_t)(rand() % chunks) * sizeof(buffer);
+		poi_read("/big", buffer, sizeof(buffer), offset, &fi);
+	}
+	double read = now();
+	poi_release("/big", &fi);
+
+	printf("randread format=v%d file_bytes=%lld reads=%d write_s=%.3f read_s=%.3f read_us=%.1f\n",
+		version, size, reads, written - start, read - written, (read - written) * 1e6 / reads);
+}
+
+/**
+ * Jumlah potongan berurutan penyusun isi file
+ * @param path path file
+ */
+static int countFragments(const char *path) {
+	Entry entry = filesystem.lookup(path);
+	if (filesystem.version == VOLUME_VERSION_EXTENT) {
+		ExtentList extents;
+		extents.load(entry);
+		return extents.extents.size();
+	}
+
+	int result = 1;
+	for (Block position = entry.getIndex(); filesystem.nextBlock[position] != END_BLOCK; position = filesystem.nextBlock[position]) {
+		if (filesystem.nextBlock[position] != position + 1) {
+			result++;
+		}
+	}
+	return result;
+}
+
+/**
+ * Mengisi volume sampai sekitar 90% dengan file kecil yang sebagian
+ * dihapus, lalu menulis file besar di sisa ruang
+ * @param image   nama file volume
+ * @param version versi format
+ */
+static void benchFullVolume(const char *image, int version) {
+	freshVolume(image, VOLUME_HASHED_DIRS, version);
+	poi_mkdir("/small", 0777);
+
+	/* isi sampai ~99% dengan file 2 KB */
+	char buffer[4096];
+	char path[64];
+	memset(buffer, 's', sizeof(buffer));
+	int files = 0;
+	double start = now();
+	while (filesystem.available > filesystem.capacity / 100) {
+		sprintf(path, "/small/f%06d", files++);
+		poi_mknod(path, S_IFREG | 0666, 0);
+		poi_write(path, buffer, 2048, 0, NULL);
+	}
+	double filled = now();
+
+	/* hapus satu dari sepuluh file, volume tersisa ~90% penuh */
+	for (int i = 0; i < files; i += 10) {
+		sprintf(path, "/small/f%06d", i);
+		poi_unlink(path);
+	}
+	int used = 100 - (long long)filesystem.available * 100 / filesystem.capacity;
+
+	/* tulis file besar per 4 KB, dua file bergantian */
+	int blocks = (filesystem.available - 1024) / 2;
+	struct fuse_file_info fa, fb;
+	memset(&fa, 0, sizeof(fa));
+	memset(&fb, 0, sizeof(fb));
+	poi_mknod("/a", S_IFREG | 0666, 0);
+	poi_mknod("/b", S_IFREG | 0666, 0);
+	poi_open("/a", &fa);
+	poi_open("/b", &fb);
+	double bigStart = now();
+	for (off_t offset = 0; offset + (off_t)sizeof(buffer) <= (off_t)blocks * filesystem.blockSize; offset += sizeof(buffer)) {
+		poi_write("/a", buffer, sizeof(buffer), offset, &fa);
+		poi_write("/b", buffer, sizeof(buffer), offset, &fb);
+	}
+	double bigEnd = now();
+	poi_release("/a", &fa);
+	poi_release("/b", &fb);
+
+	printf("fullvolume format=v%d small_files=%d used_pct=%d fill_us=%.1f big_blocks=%d big_write_s=%.3f fragments_a=%d fragments_b=%d\n",
+		version, files, used, (filled - start) * 1e6 / files, blocks, bigEnd - bigStart,
+		countFragments("/a"), countFragments("/b"));
+}
+
+/**
+ * Menulis satu file besar per 4 KB dan menghitung penulisan metadata
+ * @param image    nama file volume
+ * @param mb       ukuran file dalam MB
+ * @param interval interval penulisan metadata dalam detik
+ */
+static void benchMetadata(const char *image, int mb, int interval) {
+	freshVolume(image, 0);
+	filesystem.syncInterval = interval;
+
+	struct fuse_file_info fi;
+	memset(&fi, 0, sizeof(fi));
+	poi_mknod("/file", S_IFREG | 0666, 0);
+	poi_open("/file", &fi);
+
+	char buffer[4096];
+	memset(buffer, 'm', sizeof(buffer));
+	unsigned long before = filesystem.metadataWrites;
+	double start = now();
+	for (off_t offset = 0; offset < (off_t)mb * 1024 * 1024; offset += sizeof(buffer)) {
+		poi_write("/file", buffer, sizeof(buffer), offset, &fi);
+	}
+	poi_fsync("/file", 0, &fi);
+	double end = now();
+	poi_release("/file", &fi);
+
+	printf("metadata sync_s=%d file_mb=%d metadata_writes=%lu write_s=%.3f\n",
+		interval, mb, filesystem.metadataWrites - before, end - start);
+}
+
+/* parameter satu thread pembaca */
+struct ReaderArgs {
+	int seed;
+	int reads;
+	long long chunks;
+};
+
+/**
+ * Thread pembaca: baca acak 4 KB melalui handle sendiri
+ */
+static void *randomReader(void *arg) {
+	ReaderArgs *args = (ReaderArgs*)arg;
+	struct fuse_file_info fi;
+	memset(&fi, 0, sizeof(fi));
+	poi_open("/shared", &fi);
+
+	char buffer[4096];
+	unsigned int seed = args->seed;
+	for (int i = 0; i < args->reads; i++) {
+		off_t offset = (off_t)(rand_r(&seed) % args->chunks) * sizeof(buffer);
+		poi_read("/shared", buffer, sizeof(buffer), offset, &fi);
+	}
+	poi_release("/shared", &fi);
+	return NULL;
+}
+
+/**
+ * Pembaca paralel pada satu file, throughput per jumlah thread
+ * @param image   nama file volume
+ * @param threads jumlah thread maksimum
+ * @param reads   jumlah pembacaan per thread
+ * @param backend backend volume
+ */
+static void benchParallelRead(const char *image, int threads, int reads, int backend) {
+	filesystem.~POI();
+	new (&filesystem) POI();
+	filesystem.backend = backend;
+	filesystem.create(image, 0, VOLUME_VERSION_EXTENT);
+	filesystem.load(image);
+
+	/* file 16 MB */
+	long long size = 16LL * 1024 * 1024;
+	char buffer[4096];
+	memset(buffer, 'p', sizeof(buffer));
+	poi_mknod("/shared", S_IFREG | 0666, 0);
+	for (long long offset = 0; offset < size; offset += sizeof(buffer)) {
+		poi_write("/shared", buffer, sizeof(buffer), offset, NULL);
+	}
+	filesystem.flush();
+
+	double base = 0;
+	for (int n = 1; n <= threads; n *= 2) {
+		vector<pthread_t> ids(n);
+		vector<ReaderArgs> args(n);
+		double start = now();
+		for (int i = 0; i < n; i++) {
+			args[i].seed = i + 1;
+			args[i].reads = reads;
+			args[i].chunks = size / sizeof(buffer);
+			pthread_create(&ids[i], NULL, randomReader, &args[i]);
+		}
+		for (int i = 0; i < n; i++) {
+			pthread_join(ids[i], NULL);
+		}
+		double elapsed = now() - start;
+
+		double rate = (double)n * reads / elapsed;
+		if (n == 1) {
+			base = rate;
+		}
+		printf("parallel backend=%s threads=%d reads=%d read_s=%.3f reads_per_s=%.0f speedup=%.2f\n",
+			backend == BACKEND_MMAP ? "mmap" : "stream", n, n * reads, elapsed, rate, rate / base);
+	}
+}
+
+/**
+ * Tulis lalu baca berurutan satu file dengan ukuran blok tertentu
+ * @param image     nama file volume
+ * @param mb        ukuran file dalam MB
+ * @param blockSize ukuran blok volume
+ */
+static void benchGeometry(const char *image, int mb, int blockSize) {
+	/* volume sedikit lebih besar dari file, pointer 32 bit */
+	long long size = (long long)mb * 1024 * 1024;
+	filesystem.~POI();
+	new (&filesystem) POI();
+	filesystem.create(image, 0, VOLUME_VERSION_EXTENT, blockSize, 4, size / blockSize + 1024);
+	filesystem.load(image);
+
+	vector<char> buffer(64 * 1024, 'g');
+	poi_mknod("/seq", S_IFREG | 0666, 0);
+	struct fuse_file_info fi;
+	memset(&fi, 0, sizeof(fi));
+	poi_open("/seq", &fi);
+
+	double start = now();
+	for (long long offset = 0; offset < size; offset += buffer.size()) {
+		poi_write("/seq", &buffer[0], buffer.size(), offset, &fi);
+	}
+	poi_fsync("/seq", 0, &fi);
+	double written = now();
+	for (long long offset = 0; offset < size; offset += buffer.size()) {
+		poi_read("/seq", &buffer[0], buffer.size(), offset, &fi);
+	}
+	double read = now();
+	poi_release("/seq", &fi);
+
+	printf("geometry block_size=%d file_mb=%d write_mb_s=%.1f read_mb_s=%.1f fragments=%d\n",
+		blockSize, mb, mb / (written - start), mb / (read - written), countFragments("/seq"));
+}
+
+/**
+ * Waktu membuat volume baru (-new) untuk satu geometri
+ * @param image     nama file volume
+ * @param size      ukuran volume dalam byte
+ * @param blockSize ukuran blok volume
+ */
+static void benchCreate(const char *image, long long size, int blockSize) {
+	Block blocks = size / blockSize;
+	int pointerWidth = blocks > N_BLOCK ? 4 : 2;
+
+	filesystem.~POI();
+	new (&filesystem) POI();
+	double start = now();
+	filesystem.create(image, 0, VOLUME_VERSION_EXTENT, blockSize, pointerWidth, blocks);
+	double end = now();
+
+	/* sparse file: ukuran logis penuh, blok disk hanya untuk yang ditulis */
+	struct stat stbuf;
+	stat(image, &stbuf);
+	printf("create volume_mb=%lld block_size=%d pointer_bits=%d create_ms=%.3f file_mb=%lld disk_kb=%lld\n",
+		size >> 20, blockSize, pointerWidth * 8, (end - start) * 1e3,
+		(long long)stbuf.st_size >> 20, (long long)stbuf.st_blocks / 2);
+	unlink(image);
+}
+
+/**
+ * Waktu dari load volume sampai permintaan pertama selesai
+ * @param image     nama file volume
+ * @param size      ukuran volume dalam byte
+ * @param blockSize ukuran blok volume
+ * @param backend   backend volume
+ */
+static void benchStartup(const char *image, long long size, int blockSize, int backend) {
+	Block blocks = size / blockSize;
+	filesystem.~POI();
+	new (&filesystem) POI();
+	filesystem.create(image, 0, VOLUME_VERSION_EXTENT, blockSize, blocks > N_BLOCK ? 4 : 2, blocks);
+	filesystem.load(image);
+	poi_mknod("/first", S_IFREG | 0666, 0);
+	filesystem.close();
+
+	/* seperti mount: volume dibuka lalu getattr pertama dilayani */
+	filesystem.~POI();
+	new (&filesystem) POI();
+	filesystem.backend = backend;
+	struct stat stbuf;
+	double start = now();
+	filesystem.load(image);
+	double loaded = now();
+	poi_getattr("/first", &stbuf);
+	double first = now();
+
+	printf("startup volume_mb=%lld block_size=%d backend=%s load_ms=%.3f first_request_ms=%.3f\n",
+		size >> 20, blockSize, backend == BACKEND_MMAP ? "mmap" : "stream",
+		(loaded - start) * 1e3, (first - start) * 1e3);
+	filesystem.close();
+	unlink(image);
+}
+
+/**
+ * Membaca satu potongan lewat read_buf seperti yang dilakukan fuse:
+ * isi bufvec disalin ke buffer balasan lalu bufvec dibebaskan
+ */
+static void readBuffered(const char *path, char *buffer, size_t size, off_t offset, struct fuse_file_info *fi) {
+	struct fuse_bufvec *src = NULL;
+	poi_read_buf(path, &src, size, offset, fi);
+	struct fuse_bufvec dst = FUSE_BUFVEC_INIT(size);
+	dst.buf[0].mem = buffer;
+	fuse_buf_copy(&dst, src, (enum fuse_buf_copy_flags)0);
+	for (size_t i = 0; i < src->count; i++) {
+		if (!(src->buf[i].flags & FUSE_BUF_IS_FD)) {
+			free(src->buf[i].mem);
+		}
+	}
+	free(src);
+}
+
+/**
+ * Baca/tulis berurutan per 128 KB lewat read/write dibanding read_buf/write_buf
+ * @param image nama file volume
+ * @param mb    ukuran file dalam MB
+ */
+static void benchBufferedIO(const char *image, int mb) {
+	long long size = (long long)mb * 1024 * 1024;
+	filesystem.~POI();
+	new (&filesystem) POI();
+	filesystem.create(image, 0, VOLUME_VERSION_EXTENT, 4096, 4, 2 * size / 4096 + 1024);
+	filesystem.load(image);
+
+	vector<char> buffer(128 * 1024, 'z');
+	struct fuse_file_info fi;
+	memset(&fi, 0, sizeof(fi));
+	poi_mknod("/copy", S_IFREG | 0666, 0);
+	poi_mknod("/splice", S_IFREG | 0666, 0);
+
+	poi_open("/copy", &fi);
+	double start = now();
+	for (long long offset = 0; offset < size; offset += buffer.size()) {
+		poi_write("/copy", &buffer[0], buffer.size(), offset, &fi);
+	}
+	poi_fsync("/copy", 0, &fi);
+	double written = now();
+	for (long long offset = 0; offset < size; offset += buffer.size()) {
+		poi_read("/copy", &buffer[0], buffer.size(), offset, &fi);
+	}
+	double read = now();
+	poi_release("/copy", &fi);
+	printf("bufio path=read_write file_mb=%d write_mb_s=%.1f read_mb_s=%.1f\n",
+		mb, mb / (written - start), mb / (read - written));
+
+	poi_open("/splice", &fi);
+	start = now();
+	for (long long offset = 0; offset < size; offset += buffer.size()) {
+		struct fuse_bufvec src = FUSE_BUFVEC_INIT(buffer.size());
+		src.buf[0].mem = &buffer[0];
+		poi_write_buf("/splice", &src, offset, &fi);
+	}
+	poi_fsync("/splice", 0, &fi);
+	written = now();
+	for (long long offset = 0; offset < size; offset += buffer.size()) {
+		readBuffered("/splice", &buffer[0], buffer.size(), offset, &fi);
+	}
+	read = now();
+	poi_release("/splice", &fi);
+	printf("bufio path=read_buf_write_buf file_mb=%d write_mb_s=%.1f read_mb_s=%.1f\n",
+		mb, mb / (written - start), mb / (read - written));
+}
+
+/**
+ * Baca berurutan lalu acak per 4 KB setelah volume dimuat ulang
+ * (cache kosong), dengan atau tanpa readahead
+ * @param image     nama file volume
+ * @param mb        ukuran file dalam MB
+ * @param version   versi format
+ * @param readahead jendela readahead maksimum dalam byte, 0 = mati
+ */
+static void benchReadahead(const char *image, int mb, int version, int readahead) {
+	freshVolume(image, 0, version);
+	long long size = (long long)mb * 1024 * 1024;
+	struct fuse_file_info fi;
+	memset(&fi, 0, sizeof(fi));
+	poi_mknod("/stream", S_IFREG | 0666, 0);
+	poi_open("/stream", &fi);
+	char buffer[4096];
+	memset(buffer, 's', sizeof(buffer));
+	for (long long offset = 0; offset < size; offset += sizeof(buffer)) {
+		poi_write("/stream", buffer, sizeof(buffer), offset, &fi);
+	}
+	poi_release("/stream", &fi);
+
+	filesystem.close();
+	filesystem.~POI();
+	new (&filesystem) POI();
+	filesystem.readaheadMax = readahead;
+	filesystem.load(image);
+
+	poi_open("/stream", &fi);
+	double start = now();
+	for (long long offset = 0; offset < size; offset += sizeof(buffer)) {
+		poi_read("/stream", buffer, sizeof(buffer), offset, &fi);
+	}
+	double sequential = now();
+	unsigned long hits = filesystem.cache.readaheadHits;
+	unsigned long prefetched = filesystem.cache.prefetched;
+
+	srand(1);
+	int reads = 5000;
+	for (int i = 0; i < reads; i++) {
+		poi_read("/stream", buffer, sizeof(buffer), (off_t)(rand() % (size / 4096)) * 4096, &fi);
+	}
+	double random = now();
+	poi_release("/stream", &fi);
+
+	printf("readahead format=v%d window_kb=%d file_mb=%d seq_mb_s=%.1f seq_prefetched=%lu seq_hits=%lu "
+		"rand_read_us=%.1f rand_prefetched=%lu wasted=%lu\n",
+		version, readahead / 1024, mb, mb / (sequential - start), prefetched, hits,
+		(random - sequential) * 1e6 / reads, filesystem.cache.prefetched - prefetched,
+		filesystem.cache.readaheadWasted);
+}
+
+/**
+ * Baca acak 4 KB langsung ke backend dalam batch sebesar kedalaman
+ * antrean, membandingkan pread satu per satu dengan io_uring
+ * @param image   nama file volume
+ * @param mb      ukuran data pool yang diisi dalam MB
+ * @param backend BACKEND_STREAM atau BACKEND_URING
+ * @param depth   jumlah permintaan per batch
+ */
+static void benchQueueDepth(const char *image, int mb, int backend, int depth) {
+	filesystem.~POI();
+	new (&filesystem) POI();
+	filesystem.backend = backend;
+	filesystem.ioDepth = depth;
+	filesystem.cache.setBudget(0);
+	filesystem.load(image);
+
+	Block blocks = min((Block)((long long)mb * 1024 * 1024 / filesystem.blockSize), filesystem.capacity);
+	int reads = 20000;
+	vector<char> buffer((size_t)depth * 4096);
+	vector<IORequest> batch(depth);
+	srand(1);
+	double start = now();
+	for (int i = 0; i < reads; i += depth) {
+		for (int j = 0; j < depth; j++) {
+			batch[j].position = filesystem.blockOffset(rand() % blocks);
+			batch[j].buffer = &buffer[(size_t)j * 4096];
+			batch[j].size = 4096;
+		}
+		filesystem.storage->readBatch(batch);
+	}
+	double end = now();
+
+	bool uring = backend == BACKEND_URING && ((UringStorage*)filesystem.storage)->available();
+	printf("iodepth backend=%s depth=%d reads=%d iops=%.0f mb_s=%.1f\n",
+		backend == BACKEND_STREAM ? "pread" : uring ? "io_uring" : "uring_fallback",
+		depth, reads, reads / (end - start), reads * 4096.0 / (1024 * 1024) / (end - start));
+	filesystem.close();
+}
+
+/**
+ * Membuat n file 100 byte lalu stat+baca semuanya setelah volume
+ * dimuat ulang, dengan atau tanpa isi inline
+ * @param image      nama file volume
+ * @param n          jumlah file
+ * @param inlineData volume VOLUME_INLINE_DATA
+ */
+static void benchSmallFiles(const char *image, int n, bool inlineData) {
+	filesystem.~POI();
+	new (&filesystem) POI();
+	filesystem.create(image, VOLUME_HASHED_DIRS | (inlineData ? VOLUME_INLINE_DATA : 0), VOLUME_VERSION_EXTENT, 4096, 4, (Block)n + 4096);
+	filesystem.load(image);
+
+	char path[32];
+	char content[100];
+	memset(content, 's', sizeof(content));
+	Block before = filesystem.available;
+	double start = now();
+	for (int i = 0; i < n; i++) {
+		sprintf(path, "/s%d", i);
+		poi_mknod(path, S_IFREG | 0666, 0);
+		poi_write(path, content, sizeof(content), 0, NULL);
+	}
+	filesystem.flush();
+	double created = now();
+	Block used = before - filesystem.available;
+	filesystem.close();
+
+	/* cache kosong: stat lalu baca setiap file */
+	filesystem.~POI();
+	new (&filesystem) POI();
+	filesystem.load(image);
+	unsigned long reads = filesystem.stats.io[IO_READ].count;
+	struct stat stbuf;
+	double loaded = now();
+	for (int i = 0; i < n; i++) {
+		sprintf(path, "/s%d", i);
+		poi_getattr(path, &stbuf);
+		poi_read(path, content, sizeof(content), 0, NULL);
+	}
+	double read = now();
+
+	printf("smallfile inline=%d files=%d blocks_used=%u create_us=%.1f stat_read_us=%.1f preads_per_file=%.2f\n",
+		inlineData, n, used, (created - start) * 1e6 / n, (read - loaded) * 1e6 / n,
+		(double)(filesystem.stats.io[IO_READ].count - reads) / n);
+	filesystem.close();
+}
+
+/**
+ * Membuat n file kosong dengan mode durabilitas tertentu
+ * @param image      nama file volume
+ * @param n          jumlah file
+ * @param durability mode durabilitas (DURABILITY_*)
+ * @param fsync      fsync setelah setiap pembuatan file
+ */
+/**
+ * Beberapa penulis mengisi file masing-masing bergantian per 64 KB,
+ * dengan atau tanpa fallocate ukuran akhir lebih dulu
+ * @param image     file volume
+ * @param files     jumlah file
+ * @param mb        ukuran tiap file
+ * @param version   format volume
+ * @param prealloc  panggil fallocate sebelum menulis
+ */
+static void benchPreallocate(const char *image, int files, int mb, int version, bool prealloc) {
+	filesystem.~POI();
+	new (&filesystem) POI();
+	filesystem.create(image, 0, version, 4096, 4, (Block)files * mb * 256 + 4096);
+	filesystem.load(image);
+
+	char path[32];
+	double start = now();
+	for (int i = 0; i < files; i++) {
+		sprintf(path, "/w%d", i);
+		poi_mknod(path, S_IFREG | 0666, 0);
+		if (prealloc) {
+			poi_fallocate(path, 0, 0, (off_t)mb << 20, NULL);
+		}
+	}
+	vector<char> buffer(64 << 10, 'w');
+	for (off_t offset = 0; offset < (off_t)mb << 20; offset += buffer.size()) {
+		for (int i = 0; i < files; i++) {
+			sprintf(path, "/w%d", i);
+			poi_write(path, &buffer[0], buffer.size(), offset, NULL);
+		}
+	}
+	filesystem.flush();
+	double end = now();
+
+	int fragments = 0;
+	for (int i = 0; i < files; i++) {
+		sprintf(path, "/w%d", i);
+		fragments += countFragments(path);
+	}
+	printf("prealloc version=%d fallocate=%d files=%d mb=%d fragments_per_file=%.1f write_mb_s=%.1f\n",
+		version, prealloc, files, mb, (double)fragments / files, files * mb / (end - start));
+	filesystem.close();
+}
+
+/**
+ * Volume terpecah (penulis bergantian, direktori dengan banyak slot
+ * kosong), lalu satu putaran defragmentasi dengan batas kecepatan
+ * @param image   file volume
+ * @param mb      ukuran tiap file
+ * @param version format volume
+ * @param rate    batas MB/detik, 0 = tanpa batas
+ */
+static void benchDefrag(const char *image, int mb, int version, unsigned int rate) {
+	int files = 8;
+	filesystem.~POI();
+	new (&filesystem) POI();
+	filesystem.create(image, 0, version, 4096, 4, (Block)files * mb * 256 * 2 + 4096);
+	filesystem.load(image);
+
+	char path[32];
+	vector<char> buffer(64 << 10, 'd');
+	for (int i = 0; i < files; i++) {
+		sprintf(path, "/w%d", i);
+		poi_mknod(path, S_IFREG | 0666, 0);
+	}
+	for (off_t offset = 0; offset < (off_t)mb << 20; offset += buffer.size()) {
+		for (int i = 0; i < files; i++) {
+			sprintf(path, "/w%d", i);
+			poi_write(path, &buffer[0], buffer.size(), offset, NULL);
+		}
+	}
+	for (int i = 0; i < 20000; i++) {
+		sprintf(path, "/e%d", i);
+		poi_mknod(path, S_IFREG | 0666, 0);
+	}
+	for (int i = 0; i < 20000; i++) {
+		if (i % 20 != 0) {
+			sprintf(path, "/e%d", i);
+			poi_unlink(path);
+		}
+	}
+	filesystem.flush();
+
+	/* baca berurutan seluruh file, cache kosong */
+	vector<char> chunk(1 << 20);
+	filesystem.cache.clear();
+	double start = now();
+	for (int i = 0; i < files; i++) {
+		sprintf(path, "/w%d", i);
+		for (off_t offset = 0; offset < (off_t)mb << 20; offset += chunk.size()) {
+			poi_read(path, &chunk[0], chunk.size(), offset, NULL);
+		}
+	}
+	double before = now() - start;
+
+	filesystem.defrag.rate = rate;
+	start = now();
+	filesystem.defrag.pass();
+	filesystem.flush();
+	double pass = now() - start;
+
+	filesystem.cache.clear();
+	start = now();
+	for (int i = 0; i < files; i++) {
+		sprintf(path, "/w%d", i);
+		for (off_t offset = 0; offset < (off_t)mb << 20; offset += chunk.size()) {
+			poi_read(path, &chunk[0], chunk.size(), offset, NULL);
+		}
+	}
+	double after = now() - start;
+
+	printf("defrag version=%d rate=%u score=%.2f->%.2f files_moved=%lu blocks_moved=%lu dir_blocks_freed=%lu pass_s=%.2f read_s=%.3f->%.3f\n",
+		version, rate, filesystem.defrag.scoreBefore, filesystem.defrag.scoreAfter, filesystem.defrag.filesMoved,
+		filesystem.defrag.blocksMoved, filesystem.defrag.directoryBlocksFreed, pass, before, after);
+	filesystem.close();
+}
+
+/**
+ * Pemeriksaan volume (poi-fsck) dengan jumlah thread berbeda; volume
+ * berisi banyak direktori dan file yang ditulis bergantian sehingga
+ * rantai dan extent-nya terpecah
+ * @param image   file volume
+ * @param mb      total isi file
+ * @param version format volume
+ */
+static void benchCheck(const char *image, int mb, int version) {
+	int directories = 64;
+	int files = 64;
+	filesystem.~POI();
+	new (&filesystem) POI();
+	filesystem.create(image, VOLUME_HASHED_DIRS, version, 4096, 4, (Block)mb * 256 + 65536);
+	filesystem.load(image);
+
+	char path[64];
+	for (int i = 0; i < directories; i++) {
+		sprintf(path, "/d%d", i);
+		poi_mkdir(path, 0777);
+		for (int j = 0; j < files; j++) {
+			sprintf(path, "/d%d/f%d", i, j);
+			poi_mknod(path, S_IFREG | 0666, 0);
+		}
+	}
+	size_t chunk = 64 << 10;
+	vector<char> buffer(chunk, 'k');
+	off_t size = ((off_t)mb << 20) / (directories * files);
+	for (off_t offset = 0; offset < size; offset += chunk) {
+		for (int i = 0; i < directories; i++) {
+			for (int j = 0; j < files; j++) {
+				sprintf(path, "/d%d/f%d", i, j);
+				poi_write(path, &buffer[0], min((off_t)chunk, size - offset), offset, NULL);
+			}
+		}
+	}
+	filesystem.close();
+
+	int threads[] = {1, 2, 4, 8};
+	for (int i = 0; i < 4; i++) {
+		filesystem.~POI();
+		new (&filesystem) POI();
+		filesystem.load(image);
+		filesystem.cache.setBudget(0);
+
+		Checker checker;
+		checker.threads = threads[i];
+		double start = now();
+		int result = checker.run(false);
+		double elapsed = now() - start;
+		printf("fsck version=%d mb=%d threads=%d dirs=%lu files=%lu used_blocks=%u result=%d check_s=%.3f\n",
+			version, mb, threads[i], checker.directories, checker.files,
+			filesystem.capacity - checker.freeBlocks, result, elapsed);
+		filesystem.close();
+	}
+}
+
+/**
+ * Menyalin file besar dengan link: format v1 menyalin isi, format v2
+ * memakai blok bersama (copy-on-write), lalu menulis acak ke salinan
+ * @param image   file volume
+ * @param mb      ukuran file
+ * @param version format volume
+ */
+static void benchClone(const char *image, int mb, int version) {
+	filesystem.~POI();
+	new (&filesystem) POI();
+	filesystem.create(image, 0, version, 4096, 4, (Block)mb * 256 * 3 + 4096);
+	filesystem.load(image);
+
+	vector<char> buffer(1 << 20, 'c');
+	poi_mknod("/src", S_IFREG | 0666, 0);
+	for (int i = 0; i < mb; i++) {
+		poi_write("/src", &buffer[0], buffer.size(), (off_t)i << 20, NULL);
+	}
+	filesystem.flush();
+
+	Block before = filesystem.available;
+	double start = now();
+	poi_link("/src", "/copy");
+	filesystem.flush();
+	double linked = now();
+	Block used = before - filesystem.available;
+
+	/* tulisan 4 KB acak ke salinan, blok bersama disalin dulu */
+	int writes = 1000;
+	srand(1);
+	double written = now();
+	for (int i = 0; i < writes; i++) {
+		off_t offset = (off_t)(rand() % (mb * 256)) * 4096;
+		poi_write("/copy", &buffer[0], 4096, offset, NULL);
+	}
+	filesystem.flush();
+	double end = now();
+
+	printf("clone version=%d mb=%d link_ms=%.2f blocks_used=%u write_us=%.1f shared_left=%lu\n",
+		version, mb, (linked - start) * 1e3, used, (end - written) * 1e6 / writes,
+		(unsigned long)filesystem.sharedBlocks);
+	filesystem.close();
+}
+
+static void benchJournal(const char *image, int n, int durability, bool fsync) {
+	filesystem.~POI();
+	new (&filesystem) POI();
+	filesystem.create(image, VOLUME_HASHED_DIRS);
+	filesystem.durability = durability;
+	filesystem.load(image);
+
+	unsigned long before = filesystem.metadataWrites;
+	double start = now();
+	for (int i = 0; i < n; i++) {
+		char path[32];
+		sprintf(path, "/f%d", i);
+		poi_mknod(path, S_IFREG | 0666, 0);
+		if (fsync) {
+			poi_fsync(path, 0, NULL);
+		}
+	}
+	filesystem.flush();
+	double end = now();
+
+	const char *names[] = {"none", "group", "op"};
+	printf("journal durability=%s fsync_per_op=%d files=%d creates_per_s=%.0f commits=%lu metadata_writes=%lu\n",
+		names[durability], fsync, n, n / (end - start), filesystem.journal.commits,
+		filesystem.metadataWrites - before);
+}
+
+/* sampel latensi satu jenis operasi pada suite */
+struct Latency {
+	vector<double> samples;
+	double begin;
+	double total;
+
+	Latency() : begin(0), total(0) {}
+
+	void start() {
+		begin = now();
+	}
+
+	void stop() {
+		double elapsed = now() - begin;
+		samples.push_back(elapsed);
+		total += elapsed;
+	}
+
+	/* nilai persentil p (0-100) dalam mikrodetik */
+	double percentile(double p) {
+		if (samples.empty()) {
+			return 0;
+		}
+		size_t index = (size_t)(p / 100 * (samples.size() - 1) + 0.5);
+		nth_element(samples.begin(), samples.begin() + index, samples.end());
+		return samples[index] * 1e6;
+	}
+
+	/**
+	 * Mencetak satu baris hasil: jumlah operasi, throughput, persentil
+	 * @param name  nama kasus
+	 * @param extra pasangan key=value tambahan, boleh kosong
+	 * @param bytes byte yang dipindahkan, 0 jika bukan operasi data
+	 */
+	void report(const char *name, const string &extra, long long bytes = 0) {
+		printf("suite case=%s%s%s ops=%zu ops_per_s=%.0f", name, extra.empty() ? "" : " ", extra.c_str(),
+			samples.size(), total > 0 ? samples.size() / total : 0);
+		if (bytes > 0) {
+			printf(" mb_s=%.1f", total > 0 ? bytes / total / (1024 * 1024) : 0);
+		}
+		double p50 = percentile(50), p90 = percentile(90), p99 = percentile(99), max = percentile(100);
+		printf(" p50_us=%.1f p90_us=%.1f p99_us=%.1f max_us=%.1f\n", p50, p90, p99, max);
+		fflush(stdout);
+	}
+};
+
+/**
+ * Volume suite: format v2, direktori hashed, blok 4 KB
+ * @param image nama file volume
+ * @param mb    ukuran volume dalam MB
+ */
+static void suiteVolume(const char *image, int mb) {
+	filesystem.~POI();
+	new (&filesystem) POI();
+	filesystem.create(image, VOLUME_HASHED_DIRS, VOLUME_VERSION_EXTENT, 4096, 4, (Block)mb * 256);
+	filesystem.load(image);
+}
+
+/**
+ * Badai create, stat, lalu unlink n file di satu direktori
+ * @param image nama file volume
+ * @param n     jumlah file
+ */
+static void suiteStorm(const char *image, int n) {
+	suiteVolume(image, n / 256 + 64);
+	poi_mkdir("/storm", 0777);
+
+	char path[64];
+	struct stat stbuf;
+	Latency create, getattr, unlink;
+	for (int i = 0; i < n; i++) {
+		sprintf(path, "/storm/f%07d", i);
+		create.start();
+		poi_mknod(path, S_IFREG | 0666, 0);
+		create.stop();
+	}
+	for (int i = 0; i < n; i++) {
+		sprintf(path, "/storm/f%07d", i);
+		getattr.start();
+		poi_getattr(path, &stbuf);
+		getattr.stop();
+	}
+	for (int i = 0; i < n; i++) {
+		sprintf(path, "/storm/f%07d", i);
+		unlink.start();
+		poi_unlink(path);
+		unlink.stop();
+	}
+
+	char extra[64];
+	sprintf(extra, "files=%d", n);
+	create.report("create", extra);
+	getattr.report("stat", extra);
+	unlink.report("unlink", extra);
+}
+
+/**
+ * Lookup path sedalam depth direktori, dengan dentry cache kosong
+ * (setiap komponen dibaca dari direktori) dan dengan dentry cache
+ * @param image nama file volume
+ * @param depth kedalaman direktori
+ * @param n     jumlah lookup
+ */
+static void suiteDeepPath(const char *image, int depth, int n) {
+	suiteVolume(image, 64);
+
+	string path;
+	for (int i = 0; i < depth; i++) {
+		char name[16];
+		sprintf(name, "/d%02d", i);
+		path += name;
+		poi_mkdir(path.c_str(), 0777);
+	}
+	path += "/leaf";
+	poi_mknod(path.c_str(), S_IFREG | 0666, 0);
+
+	struct stat stbuf;
+	for (int cached = 0; cached <= 1; cached++) {
+		filesystem.dentry.setCapacity(cached ? DENTRY_CAPACITY : 0);
+		Latency lookup;
+		for (int i = 0; i < n; i++) {
+			lookup.start();
+			poi_getattr(path.c_str(), &stbuf);
+			lookup.stop();
+		}
+		char extra[64];
+		sprintf(extra, "depth=%d dentry=%s", depth, cached ? "on" : "off");
+		lookup.report("deeppath", extra);
+	}
+}
+
+/* filler readdir yang hanya menghitung entry */
+static int countEntry(void *buf, const char *name, const struct stat *stbuf, off_t offset) {
+	(*(int*)buf)++;
+	return 0;
+}
+
+/**
+ * Mengisi satu direktori dengan n file lalu membacanya dengan readdir
+ * @param image nama file volume
+ * @param n     jumlah file
+ */
+static void suitePopulate(const char *image, int n) {
+	suiteVolume(image, n / 256 + 64);
+	filesystem.dentry.setCapacity(0);
+	poi_mkdir("/big", 0777);
+
+	char path[64];
+	Latency create, readdir;
+	for (int i = 0; i < n; i++) {
+		sprintf(path, "/big/entry-with-a-longer-name-%07d", i);
+		create.start();
+		poi_mknod(path, S_IFREG | 0666, 0);
+		create.stop();
+	}
+	int entries = 0;
+	for (int i = 0; i < 5; i++) {
+		entries = 0;
+		readdir.start();
+		poi_readdir("/big", &entries, countEntry, 0, NULL);
+		readdir.stop();
+	}
+
+	char extra[64];
+	sprintf(extra, "files=%d", n);
+	create.report("populate", extra);
+	sprintf(extra, "files=%d entries=%d", n, entries);
+	readdir.report("readdir", extra);
+}
+
+/**
+ * Baca/tulis berurutan dan acak pada satu file dengan ukuran permintaan
+ * tertentu; isi cache dibuang sebelum setiap fase baca
+ * @param image nama file volume
+ * @param mb    ukuran file dalam MB
+ * @param size  ukuran satu permintaan dalam byte
+ */
+static void suiteReadWrite(const char *image, int mb, int size) {
+	long long fileSize = (long long)mb * 1024 * 1024;
+	suiteVolume(image, mb * 2 + 64);
+
+	vector<char> buffer(size, 'r');
+	struct fuse_file_info fi;
+	memset(&fi, 0, sizeof(fi));
+	poi_mknod("/io", S_IFREG | 0666, 0);
+	poi_open("/io", &fi);
+
+	Latency seqWrite, seqRead, randWrite, randRead;
+	for (long long offset = 0; offset < fileSize; offset += size) {
+		seqWrite.start();
+		poi_write("/io", &buffer[0], size, offset, &fi);
+		seqWrite.stop();
+	}
+	poi_fsync("/io", 0, &fi);
+	filesystem.cache.flush();
+	filesystem.cache.clear();
+	for (long long offset = 0; offset < fileSize; offset += size) {
+		seqRead.start();
+		poi_read("/io", &buffer[0], size, offset, &fi);
+		seqRead.stop();
+	}
+
+	/* acak: seperempat isi file, permintaan sejajar ukurannya */
+	long long chunks = fileSize / size;
+	long long count = max(chunks / 4, 1LL);
+	srand(7);
+	for (long long i = 0; i < count; i++) {
+		off_t offset = (off_t)(rand() % chunks) * size;
+		randWrite.start();
+		poi_write("/io", &buffer[0], size, offset, &fi);
+		randWrite.stop();
+	}
+	poi_fsync("/io", 0, &fi);
+	filesystem.cache.flush();
+	filesystem.cache.clear();
+	for (long long i = 0; i < count; i++) {
+		off_t offset = (off_t)(rand() % chunks) * size;
+		randRead.start();
+		poi_read("/io", &buffer[0], size, offset, &fi);
+		randRead.stop();
+	}
+	poi_release("/io", &fi);
+
+	char extra[64];
+	sprintf(extra, "io_kb=%d file_mb=%d", size / 1024, mb);
+	seqWrite.report("seqwrite", extra, fileSize);
+	seqRead.report("seqread", extra, fileSize);
+	randWrite.report("randwrite", extra, count * size);
+	randRead.report("randread", extra, count * size);
+}
+
+/**
+ * Truncate satu file ke ukuran acak, memperbesar dan memperkecil
+ * @param image nama file volume
+ * @param mb    ukuran maksimum file dalam MB
+ * @param n     jumlah truncate
+ */
+static void suiteTruncate(const char *image, int mb, int n) {
+	suiteVolume(image, mb + 64);
+	poi_mknod("/t", S_IFREG | 0666, 0);
+
+	Latency truncate;
+	long long limit = (long long)mb * 1024 * 1024;
+	srand(11);
+	for (int i = 0; i < n; i++) {
+		off_t size = (off_t)(((long long)rand() * 4096) % limit);
+		truncate.start();
+		poi_truncate("/t", size);
+		truncate.stop();
+	}
+
+	char extra[64];
+	sprintf(extra, "max_mb=%d", mb);
+	truncate.report("truncate", extra);
+}
+
+/**
+ * Alokasi pada volume terfragmentasi: volume diisi file satu blok,
+ * separuhnya dihapus berselang-seling, lalu satu file besar ditulis
+ * per 64 KB ke sisa ruang
+ * @param image   nama file volume
+ * @param mb      ukuran volume dalam MB
+ * @param version versi format
+ */
+static void suiteFragmented(const char *image, int mb, int version) {
+	filesystem.~POI();
+	new (&filesystem) POI();
+	filesystem.create(image, VOLUME_HASHED_DIRS, version, 4096, 4, (Block)mb * 256);
+	filesystem.load(image);
+	poi_mkdir("/small", 0777);
+
+	char path[64];
+	char block[4096];
+	memset(block, 'f', sizeof(block));
+	int files = 0;
+	while (filesystem.available > filesystem.capacity / 20) {
+		sprintf(path, "/small/f%07d", files++);
+		poi_mknod(path, S_IFREG | 0666, 0);
+		poi_write(path, block, sizeof(block), 0, NULL);
+	}
+	for (int i = 0; i < files; i += 2) {
+		sprintf(path, "/small/f%07d", i);
+		poi_unlink(path);
+	}
+
+	vector<char> buffer(64 * 1024, 'F');
+	struct fuse_file_info fi;
+	memset(&fi, 0, sizeof(fi));
+	poi_mknod("/large", S_IFREG | 0666, 0);
+	poi_open("/large", &fi);
+	Latency append;
+	long long size = (long long)(filesystem.available - 256) * filesystem.blockSize;
+	size -= size % buffer.size();
+	for (long long offset = 0; offset < size; offset += buffer.size()) {
+		append.start();
+		poi_write("/large", &buffer[0], buffer.size(), offset, &fi);
+		append.stop();
+	}
+	poi_release("/large", &fi);
+
+	char extra[96];
+	sprintf(extra, "format=v%d volume_mb=%d small_files=%d fragments=%d", version, mb, files, countFragments("/large"));
+	append.report("fragalloc", extra, size);
+}
+
+/**
+ * Seluruh suite; setiap baris "suite case=... key=value" agar hasil
+ * antar rilis bisa dibandingkan
+ * @param image nama file volume
+ * @param scale pengali jumlah operasi dan ukuran data
+ */
+static void benchSuite(const char *image, int scale) {
+	suiteStorm(image, 20000 * scale);
+	suiteDeepPath(image, 32, 20000 * scale);
+	suitePopulate(image, 50000 * scale);
+	int sizes[] = {4096, 65536, 1024 * 1024};
+	for (int i = 0; i < 3; i++) {
+		suiteReadWrite(image, 64 * scale, sizes[i]);
+	}
+	suiteTruncate(image, 16 * scale, 2000 * scale);
+	suiteFragmented(image, 64 * scale, VOLUME_VERSION_FAT);
+	suiteFragmented(image, 64 * scale, VOLUME_VERSION_EXTENT);
+	filesystem.close();
+	unlink(image);
+}
+
+int main(int argc, char **argv) {
+	if (argc < 3) {
+		printf("Usage: ./bench <volume.poi> largedir [jumlah file]\n");
+		printf("       ./bench <volume.poi> randread [MB] [jumlah baca]\n");
+		printf("       ./bench <volume.poi> fullvolume\n");
+		printf("       ./bench <volume.poi> metadata [MB]\n");
+		printf("       ./bench <volume.poi> parallel [thread] [jumlah baca]\n");
+		printf("       ./bench <volume.poi> geometry [MB]\n");
+		printf("       ./bench <volume.poi> create\n");
+		printf("       ./bench <volume.poi> startup\n");
+		printf("       ./bench <volume.poi> bufio [MB]\n");
+		printf("       ./bench <volume.poi> journal [jumlah file]\n");
+		printf("       ./bench <volume.poi> readahead [MB]\n");
+		printf("       ./bench <volume.poi> iodepth [MB]\n");
+		printf("       ./bench <volume.poi> suite [skala]\n");
+		printf("       ./bench <volume.poi> smallfile [jumlah file]\n");
+		printf("       ./bench <volume.poi> clone [MB]\n");
+		printf("       ./bench <volume.poi> prealloc [MB]\n");
+		printf("       ./bench <volume.poi> defrag [MB] [MB/detik]\n");
+		printf("       ./bench <volume.poi> fsck [MB]\n");
+		printf("       ./bench <volume.poi> lsl [jumlah file]\n");
+		printf("       ./bench <volume.poi> kcache [jumlah stat]\n");
+		return 0;
+	}
+
+	const char *image = argv[1];
+	string name(argv[2]);
+
+	if (name == "largedir") {
+		int n = argc > 3 ? atoi(argv[3]) : 100000;
+		benchLargeDirectory(image, n, false);
+		benchLargeDirectory(image, n, true);
+	}
+	else if (name == "randread") {
+		int mb = argc > 3 ? atoi(argv[3]) : 100;
+		int reads = argc > 4 ? atoi(argv[4]) : 10000;
+		benchRandomRead(image, mb, reads, VOLUME_VERSION_FAT);
+		benchRandomRead(image, mb, reads, VOLUME_VERSION_EXTENT);
+	}
+	else if (name == "fullvolume") {
+		benchFullVolume(image, VOLUME_VERSION_FAT);
+		benchFullVolume(image, VOLUME_VERSION_EXTENT);
+	}
+	else if (name == "metadata") {
+		int mb = argc > 3 ? atoi(argv[3]) : 10;
+		benchMetadata(image, mb, 0);
+		benchMetadata(image, mb, METADATA_SYNC_INTERVAL);
+	}
+	else if (name == "parallel") {
+		int threads = argc > 3 ? atoi(argv[3]) : 8;
+		int reads = argc > 4 ? atoi(argv[4]) : 20000;
+		benchParallelRead(image, threads, reads, BACKEND_STREAM);
+		benchParallelRead(image, threads, reads, BACKEND_MMAP);
+	}
+	else if (name == "geometry") {
+		int mb = argc > 3 ? atoi(argv[3]) : 64;
+		benchGeometry(image, mb, 512);
+		benchGeometry(image, mb, 4096);
+		benchGeometry(image, mb, 65536);
+	}
+	else if (name == "create") {
+		benchCreate(image, 32LL << 20, 512);
+		benchCreate(image, 1LL << 30, 4096);
+		benchCreate(image, 64LL << 30, 4096);
+		benchCreate(image, 1LL << 40, 4096);
+		benchCreate(image, 8LL << 40, 65536);
+	}
+	else if (name == "bufio") {
+		int mb = argc > 3 ? atoi(argv[3]) : 256;
+		benchBufferedIO(image, mb);
+	}
+	else if (name == "journal") {
+		int n = argc > 3 ? atoi(argv[3]) : 2000;
+		benchJournal(image, n, DURABILITY_NONE, false);
+		benchJournal(image, n, DURABILITY_NONE, true);
+		benchJournal(image, n, DURABILITY_GROUP, false);
+		benchJournal(image, n, DURABILITY_OP, false);
+	}
+	else if (name == "readahead") {
+		int mb = argc > 3 ? atoi(argv[3]) : 16;
+		for (int version = VOLUME_VERSION_FAT; version <= VOLUME_VERSION_EXTENT; version++) {
+			benchReadahead(image, mb, version, 0);
+			benchReadahead(image, mb, version, READAHEAD_MAX);
+		}
+	}
+	else if (name == "iodepth") {
+		/* volume blok 4 KB yang seluruh data pool-nya berisi */
+		int mb = argc > 3 ? atoi(argv[3]) : 256;
+		filesystem.create(image, 0, VOLUME_VERSION_EXTENT, 4096, 4, (Block)((long long)mb * 256 + 1024));
+		filesystem.load(image);
+		vector<char> fill(1 << 20, 'q');
+		for (int i = 0; i < mb; i++) {
+			filesystem.storage->write(filesystem.blockOffset(0) + ((off_t)i << 20), &fill[0], fill.size());
+		}
+		filesystem.close();
+
+		int depths[] = {1, 4, 16, 64};
+		for (int i = 0; i < 4; i++) {
+			benchQueueDepth(image, mb, BACKEND_STREAM, depths[i]);
+			benchQueueDepth(image, mb, BACKEND_URING, depths[i]);
+		}
+	}
+	else if (name == "suite") {
+		int scale = argc > 3 ? max(atoi(argv[3]), 1) : 1;
+		benchSuite(image, scale);
+	}
+	else if (name == "smallfile") {
+		int n = argc > 3 ? atoi(argv[3]) : 20000;
+		benchSmallFiles(image, n, false);
+		benchSmallFiles(image, n, true);
+	}
+	else if (name == "clone") {
+		int mb = argc > 3 ? atoi(argv[3]) : 256;
+		benchClone(image, mb, VOLUME_VERSION_FAT);
+		benchClone(image, mb, VOLUME_VERSION_EXTENT);
+	}
+	else if (name == "prealloc") {
+		int mb = argc > 3 ? atoi(argv[3]) : 64;
+		for (int version = VOLUME_VERSION_FAT; version <= VOLUME_VERSION_EXTENT; version++) {
+			benchPreallocate(image, 8, mb, version, false);
+			benchPreallocate(image, 8, mb, version, true);
+		}
+	}
+	else if (name == "defrag") {
+		int mb = argc > 3 ? atoi(argv[3]) : 16;
+		unsigned int rate = argc > 4 ? atoi(argv[4]) : 0;
+		benchDefrag(image, mb, VOLUME_VERSION_FAT, rate);
+		benchDefrag(image, mb, VOLUME_VERSION_EXTENT, rate);
+	}
+	else if (name == "fsck") {
+		int mb = argc > 3 ? atoi(argv[3]) : 1024;
+		benchCheck(image, mb, VOLUME_VERSION_FAT);
+		benchCheck(image, mb, VOLUME_VERSION_EXTENT);
+	}
+	else if (name == "lsl") {
+		int n = argc > 3 ? atoi(argv[3]) : 10000;
+		for (int hashed = 0; hashed <= 1; hashed++) {
+			benchListLong(image, n, hashed, false);
+			benchListLong(image, n, hashed, true);
+		}
+	}
+	else if (name == "kcache") {
+		/* 0 = tanpa cache, KERNEL_TIMEOUT = bawaan, 60 = -kcache=60 */
+		int n = argc > 3 ? atoi(argv[3]) : 200000;
+		int timeouts[] = {0, KERNEL_TIMEOUT, 60};
+		for (int i = 0; i < 3; i++) {
+			benchKernelCache(image, timeouts[i], n);
+		}
+	}
+	else if (name == "startup") {
+		for (int backend = BACKEND_STREAM; backend <= BACKEND_MMAP; backend++) {
+			benchStartup(image, 32LL << 20, 512, backend);
+			benchStartup(image, 1LL << 30, 4096, backend);
+			benchStartup(image, 64LL << 30, 4096, backend);
+			benchStartup(image, 256LL << 30, 4096, backend);
+		}
+	}
+	else {
+		printf("Benchmark tidak dikenal: %s\n", argv[2]);
+		return 1;
+	}
+
+	return 0;
+}
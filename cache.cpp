@@ -0,0 +1,377 @@
+//////////////////////////////////
+// File cache.cpp               //
+// Cache blok data pool         //
+//////////////////////////////////
+
+#include "poi.hpp"
+
+/* Global filesystem */
+extern POI filesystem;
+
+/**
+ * Konstruktor
+ */
+BlockCache::BlockCache() : lock(true) {
+	budget = BLOCK_CACHE_BUDGET;
+	hand = 0;
+	hits = 0;
+	misses = 0;
+	evictions = 0;
+	writebacks = 0;
+	dirtyBytes = 0;
+	prefetched = 0;
+	readaheadHits = 0;
+	readaheadWasted = 0;
+}
+
+/**
+ * Mengatur batas memori cache, 0 mematikan cache
+ * @param bytes batas memori dalam byte
+ */
+void BlockCache::setBudget(size_t bytes) {
+	MutexGuard guard(lock);
+	budget = bytes;
+	if (capacity() < frames.size()) {
+		flush();
+		clear();
+	}
+}
+
+/**
+ * Membaca sebagian isi blok
+ * @param position blok
+ * @param buffer
+ * @param size
+ * @param offset   offset dalam blok
+ */
+void BlockCache::read(Block position, char *buffer, int size, int offset) {
+	MutexGuard guard(lock);
+	Frame &frame = frames[lookup(position, true)];
+	memcpy(buffer, &frame.data[offset], size);
+}
+
+/**
+ * Membaca potongan beberapa blok; blok yang belum ada dimuat
+ * bersama dalam satu batch
+ * @param requests potongan blok
+ */
+void BlockCache::read(vector<PoolRequest> &requests) {
+	MutexGuard guard(lock);
+	vector<Extent> runs;
+	for (size_t i = 0; i < requests.size(); i++) {
+		Block position = requests[i].position;
+		unordered_map<Block, int>::iterator it = table.find(position);
+		if (it != table.end()) {
+			Frame &frame = frames[it->second];
+			hits++;
+			frame.referenced = true;
+			if (frame.prefetched) {
+				frame.prefetched = false;
+				readaheadHits++;
+			}
+		}
+		else if (runs.empty() || runs.back().start + runs.back().length != position) {
+			Extent run = {position, 1};
+			runs.push_back(run);
+			misses++;
+		}
+		else {
+			runs.back().length++;
+			misses++;
+		}
+	}
+	load(runs, false);
+
+	for (size_t i = 0; i < requests.size(); i++) {
+		/* frame bisa sudah dikeluarkan lagi jika cache sangat kecil */
+		unordered_map<Block, int>::iterator it = table.find(requests[i].position);
+		int slot = it != table.end() ? it->second : lookup(requests[i].position, true);
+		memcpy(requests[i].buffer, &frames[slot].data[requests[i].offset], requests[i].size);
+	}
+}
+
+/**
+ * Menulis sebagian isi blok, blok ditandai dirty
+ * @param position blok
+ * @param buffer
+ * @param size
+ * @param offset   offset dalam blok
+ */
+void BlockCache::write(Block position, const char *buffer, int size, int offset) {
+	MutexGuard guard(lock);
+	/* blok yang ditulis penuh tidak perlu dibaca dulu */
+	Frame &frame = frames[lookup(position, offset != 0 || size != filesystem.blockSize)];
+	memcpy(&frame.data[offset], buffer, size);
+
+	if (!frame.dirty) {
+		frame.dirty = true;
+		dirtyBytes += frame.data.size();
+	}
+}
+
+/**
+ * Menulis semua blok dirty ke volume
+ */
+void BlockCache::flush() {
+	MutexGuard guard(lock);
+
+	/* semua frame dirty dikirim dalam satu batch, urut posisi */
+	vector< pair<Block, int> > dirty;
+	for (size_t i = 0; i < frames.size(); i++) {
+		if (frames[i].dirty) {
+			dirty.push_back(make_pair(frames[i].position, (int)i));
+		}
+	}
+	if (dirty.empty()) {
+		return;
+	}
+	sort(dirty.begin(), dirty.end());
+
+	vector<IORequest> batch;
+	for (size_t i = 0; i < dirty.size(); i++) {
+		Frame &frame = frames[dirty[i].second];
+		IORequest request = {filesystem.blockOffset(frame.position), &frame.data[0], frame.data.size()};
+		batch.push_back(request);
+	}
+	filesystem.storage->writeBatch(batch);
+
+	for (size_t i = 0; i < dirty.size(); i++) {
+		Frame &frame = frames[dirty[i].second];
+		frame.dirty = false;
+		dirtyBytes -= frame.data.size();
+		writebacks++;
+	}
+}
+
+/**
+ * Mengosongkan cache tanpa write-back
+ */
+void BlockCache::clear() {
+	MutexGuard guard(lock);
+	for (size_t i = 0; i < frames.size(); i++) {
+		drop(frames[i]);
+	}
+	frames.clear();
+	table.clear();
+	hand = 0;
+	dirtyBytes = 0;
+}
+
+/**
+ * Menulis satu blok jika dirty, untuk akses langsung ke file .poi
+ * @param position blok
+ * @param discard  buang juga frame-nya karena isi blok akan ditimpa
+ */
+void BlockCache::sync(Block position, bool discard) {
+	MutexGuard guard(lock);
+	unordered_map<Block, int>::iterator it = table.find(position);
+	if (it == table.end()) {
+		return;
+	}
+
+	Frame &frame = frames[it->second];
+	if (frame.dirty) {
+		writeBack(frame);
+	}
+	if (discard) {
+		/* frame kosong dipakai ulang oleh CLOCK */
+		drop(frame);
+		frame.position = END_BLOCK;
+		frame.referenced = false;
+		table.erase(it);
+	}
+}
+
+/**
+ * Membaca beberapa deret blok berurutan dalam satu batch, satu
+ * pembacaan per deret; blok yang sudah ada di cache (termasuk yang
+ * dirty) tidak disentuh
+ * @param runs deret blok
+ */
+void BlockCache::prefetch(const vector<Extent> &runs) {
+	MutexGuard guard(lock);
+	if (!enabled()) {
+		return;
+	}
+
+	/* persempit setiap deret ke blok pertama dan terakhir yang belum ada */
+	vector<Extent> missing;
+	for (size_t i = 0; i < runs.size(); i++) {
+		Extent run = runs[i];
+		while (run.length > 0 && table.count(run.start)) {
+			run.start++;
+			run.length--;
+		}
+		while (run.length > 0 && table.count(run.start + run.length - 1)) {
+			run.length--;
+		}
+		if (run.length > 0) {
+			missing.push_back(run);
+		}
+	}
+	load(missing, true);
+}
+
+/**
+ * Memuat deret blok ke frame dengan satu batch pembacaan. Setiap blok
+ * disalin ke frame-nya segera setelah frame disiapkan, sehingga eviksi
+ * di tengah batch tidak mencampur isi blok.
+ * @param runs     deret blok
+ * @param prefetch tandai sebagai hasil readahead
+ */
+void BlockCache::load(const vector<Extent> &runs, bool prefetch) {
+	if (runs.empty()) {
+		return;
+	}
+
+	int blockSize = filesystem.blockSize;
+	size_t total = 0;
+	for (size_t i = 0; i < runs.size(); i++) {
+		total += runs[i].length;
+	}
+	vector<char> buffer(total * blockSize);
+	vector<IORequest> batch;
+	size_t used = 0;
+	for (size_t i = 0; i < runs.size(); i++) {
+		IORequest request = {filesystem.blockOffset(runs[i].start), &buffer[used], (size_t)runs[i].length * blockSize};
+		batch.push_back(request);
+		used += request.size;
+	}
+	filesystem.storage->readBatch(batch);
+
+	used = 0;
+	for (size_t i = 0; i < runs.size(); i++) {
+		for (Block j = 0; j < runs[i].length; j++, used += blockSize) {
+			if (table.count(runs[i].start + j)) {
+				continue;
+			}
+			Frame &frame = frames[install(runs[i].start + j)];
+			memcpy(&frame.data[0], &buffer[used], blockSize);
+
+			/* satu putaran CLOCK, cukup untuk sampai dibaca pada baca berurutan */
+			if (prefetch) {
+				frame.prefetched = true;
+				prefetched++;
+			}
+		}
+	}
+}
+
+/**
+ * Apakah cache dipakai
+ */
+bool BlockCache::enabled() {
+	return capacity() > 0;
+}
+
+/**
+ * Rasio akses yang dilayani cache
+ */
+double BlockCache::hitRatio() {
+	MutexGuard guard(lock);
+	if (hits + misses == 0) {
+		return 0;
+	}
+	return (double)hits / (hits + misses);
+}
+
+/**
+ * Mendapatkan frame berisi blok, mengeluarkan blok lain jika penuh
+ * @param  position blok
+ * @param  load     baca isi blok dari volume jika belum ada
+ * @return          indeks frame
+ */
+int BlockCache::lookup(Block position, bool load) {
+	unordered_map<Block, int>::iterator it = table.find(position);
+	if (it != table.end()) {
+		Frame &frame = frames[it->second];
+		hits++;
+		frame.referenced = true;
+		if (frame.prefetched) {
+			frame.prefetched = false;
+			readaheadHits++;
+		}
+		return it->second;
+	}
+	misses++;
+
+	int slot = install(position);
+	if (load) {
+		Frame &frame = frames[slot];
+		filesystem.storage->read(filesystem.blockOffset(position), &frame.data[0], frame.data.size());
+	}
+	return slot;
+}
+
+/**
+ * Menyiapkan frame kosong untuk blok, mengeluarkan blok lain jika penuh
+ * @param  position blok
+ * @return          indeks frame, isinya belum dibaca
+ */
+int BlockCache::install(Block position) {
+	int slot;
+	if (frames.size() < capacity()) {
+		frames.push_back(Frame());
+		slot = frames.size() - 1;
+	}
+	else {
+		slot = victim();
+		Frame &old = frames[slot];
+		if (old.dirty) {
+			writeBack(old);
+		}
+		drop(old);
+		table.erase(old.position);
+		evictions++;
+	}
+
+	Frame &frame = frames[slot];
+	frame.position = position;
+	frame.dirty = false;
+	frame.referenced = true;
+	frame.prefetched = false;
+	frame.data.resize(filesystem.blockSize);
+	table[position] = slot;
+	return slot;
+}
+
+/**
+ * Mencatat frame yang dibuang, readahead yang belum dibaca terbuang
+ */
+void BlockCache::drop(Frame &frame) {
+	if (frame.prefetched) {
+		frame.prefetched = false;
+		readaheadWasted++;
+	}
+}
+
+/**
+ * Jumlah frame maksimum sesuai ukuran blok volume
+ */
+size_t BlockCache::capacity() {
+	return budget / filesystem.blockSize;
+}
+
+/**
+ * Memilih frame yang dikeluarkan dengan algoritma CLOCK
+ * @return indeks frame
+ */
+int BlockCache::victim() {
+	while (frames[hand].referenced) {
+		frames[hand].referenced = false;
+		hand = (hand + 1) % frames.size();
+	}
+	int result = hand;
+	hand = (hand + 1) % frames.size();
+	return result;
+}
+
+/**
+ * Menulis satu frame dirty ke volume
+ */
+void BlockCache::writeBack(Frame &frame) {
+	filesystem.storage->write(filesystem.blockOffset(frame.position), &frame.data[0], frame.data.size());
+	frame.dirty = false;
+	dirtyBytes -= frame.data.size();
+	writebacks++;
+}
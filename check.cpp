@@ -0,0 +1,426 @@
+//////////////////////////////////
+// File check.cpp               //
+// Pemeriksa volume (poi-fsck)  //
+//////////////////////////////////
+
+#include <cstdio>
+#include <unistd.h>
+#include "poi.hpp"
+
+/* Global filesystem */
+extern POI filesystem;
+
+/*
+ * Setiap rantai (direktori, tabel bucket, rantai file v1, rantai
+ * overflow extent, journal) menandai bloknya dengan FSCK_CHAIN_REF,
+ * setiap extent menambah satu rujukan. Blok rantai yang dirujuk lagi
+ * berarti rantai bersilang atau berputar; blok data v2 boleh dirujuk
+ * beberapa file asalkan allocation table menyimpan jumlahnya.
+ */
+
+/**
+ * Konstruktor, satu thread per CPU
+ */
+Checker::Checker() : lock(true) {
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	threads = cpus > 0 ? cpus : 1;
+	directories = 0;
+	files = 0;
+	structural = 0;
+	accounting = 0;
+	repaired = 0;
+	freeBlocks = 0;
+	firstFree = END_BLOCK;
+	fixTable = false;
+}
+
+/**
+ * Memeriksa volume yang sudah dimuat (journal sudah diputar ulang)
+ * @param  repair perbaiki allocation table dan header; allocation table
+ *                hanya diperbaiki jika tidak ada kesalahan struktur
+ * @return        FSCK_CLEAN, FSCK_REPAIRED atau FSCK_UNCORRECTED
+ */
+int Checker::run(bool repair) {
+	/* header apa adanya di volume, load menghitung ulang available */
+	char header[HEADER_SIZE];
+	filesystem.storage->read(0, header, HEADER_SIZE);
+	Block headerFree, headerFirst;
+	memcpy((char*)&headerFree, header + 0x28, 4);
+	memcpy((char*)&headerFirst, header + 0x2C, 4);
+
+	vector<atomic<Block> > counts(filesystem.capacity);
+	refs.swap(counts);
+	for (Block i = 0; i < filesystem.capacity; i++) {
+		refs[i] = 0;
+	}
+
+	/* pohon direktori per tingkat: direktori lalu file di dalamnya */
+	Node root;
+	root.index = 0;
+	root.hashed = (filesystem.flags & VOLUME_HASHED_ROOT) != 0;
+	root.path = "/";
+	level.assign(1, root);
+	while (!level.empty()) {
+		nextLevel.clear();
+		pending.clear();
+		parallel(level.size(), &Checker::checkDirectory);
+		parallel(pending.size(), &Checker::checkFile);
+		directories += level.size();
+		files += pending.size();
+		level.swap(nextLevel);
+	}
+
+	Journal &journal = filesystem.journal;
+	if (journal.start != 0) {
+		vector<Block> blocks;
+		claimChain(journal.start, "journal", blocks);
+		if (blocks.size() != journal.blocks) {
+			char line[128];
+			snprintf(line, sizeof(line), "journal: rantai %lu blok, header %u blok",
+				(unsigned long)blocks.size(), journal.blocks);
+			problem(line, false);
+		}
+	}
+
+	/* kesalahan struktur berarti rujukan yang terhitung belum lengkap */
+	fixTable = repair && structural == 0;
+	freeBlocks = 0;
+	firstFree = END_BLOCK;
+	parallel((filesystem.capacity + FSCK_SCAN_CHUNK - 1) / FSCK_SCAN_CHUNK, &Checker::scanTable);
+
+	for (size_t i = 0; i < fixes.size(); i++) {
+		filesystem.setNextBlock(fixes[i].position, fixes[i].value);
+	}
+	repaired += fixes.size();
+	if (!fixes.empty()) {
+		filesystem.allocator.load(&filesystem.nextBlock[0], filesystem.capacity);
+	}
+
+	if (headerFree != freeBlocks || headerFirst != firstFree) {
+		char line[128];
+		snprintf(line, sizeof(line), "header: %u blok bebas mulai blok %d, seharusnya %u mulai blok %d",
+			headerFree, (int)headerFirst, freeBlocks, (int)firstFree);
+		problem(line, true);
+		if (repair) {
+			filesystem.available = freeBlocks;
+			filesystem.firstEmpty = firstFree;
+			filesystem.writeVolumeInformation();
+			repaired++;
+		}
+	}
+	if (repaired > 0) {
+		filesystem.flushMetadata();
+		filesystem.storage->sync();
+	}
+
+	if (problems.empty()) {
+		return FSCK_CLEAN;
+	}
+	return repair && structural == 0 ? FSCK_REPAIRED : FSCK_UNCORRECTED;
+}
+
+/**
+ * Menjalankan work(0) sampai work(count - 1) dengan beberapa thread,
+ * thread pemanggil ikut bekerja
+ * @param count jumlah tugas
+ * @param work  method yang dijalankan per tugas
+ */
+void Checker::parallel(size_t count, void (Checker::*work)(size_t)) {
+	Task task;
+	task.checker = this;
+	task.work = work;
+	task.count = count;
+	task.next = 0;
+
+	size_t helpers = min((size_t)max(threads, 1), count);
+	vector<pthread_t> workers;
+	for (size_t i = 1; i < helpers; i++) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, worker, &task) == 0) {
+			workers.push_back(thread);
+		}
+	}
+	worker(&task);
+	for (size_t i = 0; i < workers.size(); i++) {
+		pthread_join(workers[i], NULL);
+	}
+}
+
+/**
+ * Isi thread pemeriksa, mengambil tugas berikutnya sampai habis
+ */
+void *Checker::worker(void *arg) {
+	Task *task = (Task*)arg;
+	for (size_t i = task->next++; i < task->count; i = task->next++) {
+		(task->checker->*task->work)(i);
+	}
+	return NULL;
+}
+
+/**
+ * Menelusuri satu rantai allocation table dan mencatat rujukannya.
+ * Penelusuran berhenti di pointer yang keluar volume dan di blok yang
+ * sudah dirujuk, sehingga rantai yang berputar tidak ditelusuri lagi.
+ * @param  first  blok pertama, END_BLOCK untuk rantai kosong
+ * @param  owner  pemilik rantai untuk pesan kesalahan
+ * @param  blocks blok rantai yang berhasil ditelusuri
+ * @return        false jika rantai rusak
+ */
+bool Checker::claimChain(Block first, const string &owner, vector<Block> &blocks) {
+	char line[128];
+	Block position = first;
+	while (position != END_BLOCK) {
+		if (position >= filesystem.capacity) {
+			snprintf(line, sizeof(line), ": pointer %u di luar volume", position);
+			problem(owner + line, false);
+			return false;
+		}
+		if (refs[position].fetch_or(FSCK_CHAIN_REF) != 0) {
+			snprintf(line, sizeof(line), ": blok %u sudah dirujuk (rantai bersilang atau berputar)", position);
+			problem(owner + line, false);
+			return false;
+		}
+		blocks.push_back(position);
+
+		/* blok kosong di tengah rantai dilaporkan scanTable */
+		Block next = filesystem.nextBlock[position];
+		if (next == EMPTY_BLOCK) {
+			return true;
+		}
+		if (isShared(next)) {
+			snprintf(line, sizeof(line), ": blok %u berisi jumlah referensi, bukan pointer rantai", position);
+			problem(owner + line, false);
+			return false;
+		}
+		position = next;
+	}
+	return true;
+}
+
+/**
+ * Apakah nilai allocation table adalah jumlah referensi blok bersama
+ */
+bool Checker::isShared(Block value) {
+	return value != END_BLOCK && value >= filesystem.capacity;
+}
+
+/**
+ * Memeriksa rantai satu direktori dan mengumpulkan isinya
+ * @param i indeks di level
+ */
+void Checker::checkDirectory(size_t i) {
+	Node directory = level[i];
+	string owner = directory.path;
+	vector<Block> entryBlocks;
+
+	if (!directory.hashed) {
+		claimChain(directory.index, owner, entryBlocks);
+	}
+	else {
+		/* tabel bucket, lalu rantai setiap bucket */
+		vector<Block> tables;
+		claimChain(directory.index, owner + " (tabel bucket)", tables);
+		vector<char> heads(filesystem.blockSize);
+		for (size_t j = 0; j < tables.size(); j++) {
+			filesystem.readPool(tables[j], 0, &heads[0], filesystem.blockSize);
+			for (int k = 0; k < filesystem.pointerPerBlock; k++) {
+				Block head = filesystem.getPointer(&heads[k * filesystem.pointerWidth]);
+				if (head != END_BLOCK) {
+					claimChain(head, owner, entryBlocks);
+				}
+			}
+		}
+	}
+
+	vector<Node> children, contents;
+	vector<char> buffer(filesystem.blockSize);
+	for (size_t j = 0; j < entryBlocks.size(); j++) {
+		filesystem.readPool(entryBlocks[j], 0, &buffer[0], filesystem.blockSize);
+		for (int k = 0; k < filesystem.entryPerBlock; k++) {
+			Node child;
+			child.entry = Entry(entryBlocks[j], k, &buffer[k * filesystem.entrySize]);
+			if (child.entry.isEmpty()) {
+				continue;
+			}
+			child.path = (directory.path == "/" ? "" : directory.path) + "/" + child.entry.getName();
+			child.index = child.entry.getIndex();
+			child.hashed = (child.entry.getAttr() & ATTR_HASHED) != 0;
+			if (child.entry.getAttr() & 0x8) {
+				children.push_back(child);
+			}
+			else {
+				contents.push_back(child);
+			}
+		}
+	}
+
+	MutexGuard guard(lock);
+	nextLevel.insert(nextLevel.end(), children.begin(), children.end());
+	pending.insert(pending.end(), contents.begin(), contents.end());
+}
+
+/**
+ * Memeriksa blok isi satu file dan ukurannya
+ * @param i indeks di pending
+ */
+void Checker::checkFile(size_t i) {
+	Node &file = pending[i];
+	Entry &entry = file.entry;
+	off_t size = entry.getSize();
+	char line[128];
+
+	if (filesystem.isInline(entry)) {
+		if (size > filesystem.inlineCapacity) {
+			snprintf(line, sizeof(line), ": isi inline %lld byte melebihi %d byte",
+				(long long)size, filesystem.inlineCapacity);
+			problem(file.path + line, false);
+		}
+		return;
+	}
+
+	unsigned long long blocks = 0;
+	if (filesystem.version == VOLUME_VERSION_EXTENT) {
+		/* rantai overflow lebih dulu, ExtentList menelusurinya */
+		vector<Block> overflow;
+		if (!claimChain(entry.getIndex(), file.path + " (extent)", overflow)) {
+			return;
+		}
+		ExtentList extents;
+		extents.load(entry);
+		for (size_t j = 0; j < extents.extents.size(); j++) {
+			Extent &extent = extents.extents[j];
+			if (extent.start >= filesystem.capacity || extent.length > filesystem.capacity - extent.start) {
+				snprintf(line, sizeof(line), ": extent %u+%u di luar volume", extent.start, extent.length);
+				problem(file.path + line, false);
+				return;
+			}
+			for (Block k = extent.start; k < extent.start + extent.length; k++) {
+				if (refs[k]++ & FSCK_CHAIN_REF) {
+					snprintf(line, sizeof(line), ": blok %u juga dipakai rantai", k);
+					problem(file.path + line, false);
+				}
+			}
+			blocks += extent.length;
+		}
+	}
+	else {
+		vector<Block> chain;
+		if (!claimChain(entry.getIndex(), file.path, chain)) {
+			return;
+		}
+		blocks = chain.size();
+	}
+
+	/* blok setelah ukuran file boleh ada (fallocate), kekurangan hanya
+	   boleh di format v2: extent yang berakhir sebelum ukuran file
+	   (truncate memperbesar) terbaca nol */
+	if (filesystem.version != VOLUME_VERSION_EXTENT && (unsigned long long)size > blocks * filesystem.blockSize) {
+		snprintf(line, sizeof(line), ": ukuran %lld byte melebihi %llu blok",
+			(long long)size, blocks);
+		problem(file.path + line, false);
+	}
+}
+
+/**
+ * Mencocokkan rujukan sepotong allocation table dengan isinya, lalu
+ * menghitung blok bebas sesudah perbaikan
+ * @param i potongan ke-i, FSCK_SCAN_CHUNK pointer
+ */
+void Checker::scanTable(size_t i) {
+	Block start = i * FSCK_SCAN_CHUNK;
+	Block end = min((unsigned long long)filesystem.capacity, (unsigned long long)start + FSCK_SCAN_CHUNK);
+	Block limit = filesystem.pointerLimit();
+	Block maxRefs = limit >= filesystem.capacity ? limit - filesystem.capacity + 1 : 0;
+
+	vector<Fix> found;
+	vector<string> messages;
+	Block freeCount = 0;
+	Block first = END_BLOCK;
+	Block leakStart = END_BLOCK;
+	char line[128];
+
+	for (Block position = start; position <= end; position++) {
+		/* deret blok bocor dilaporkan sekaligus */
+		bool leaked = position < end && refs[position] == 0 && filesystem.nextBlock[position] != EMPTY_BLOCK;
+		if (leaked && leakStart == END_BLOCK) {
+			leakStart = position;
+		}
+		if (!leaked && leakStart != END_BLOCK) {
+			snprintf(line, sizeof(line), "blok %u-%u terpakai tetapi tidak dirujuk", leakStart, position - 1);
+			messages.push_back(line);
+			leakStart = END_BLOCK;
+		}
+		if (position == end) {
+			break;
+		}
+
+		Block value = filesystem.nextBlock[position];
+		Block count = refs[position] & ~FSCK_CHAIN_REF;
+		Block fixed = value;
+		if (leaked) {
+			fixed = EMPTY_BLOCK;
+		}
+		else if (refs[position] & FSCK_CHAIN_REF) {
+			/* rujukan ganda sudah dilaporkan claimChain atau checkFile */
+			if (count == 0 && value == EMPTY_BLOCK) {
+				snprintf(line, sizeof(line), "blok %u dipakai rantai tetapi kosong", position);
+				messages.push_back(line);
+				fixed = END_BLOCK;
+			}
+		}
+		else if (count > 0) {
+			/* blok data v2 dirujuk count file: END_BLOCK atau jumlah referensi */
+			Block expected = count == 1 ? END_BLOCK : limit - (count - 1);
+			if (value != expected) {
+				Block stored = value == EMPTY_BLOCK ? 0 : isShared(value) ? limit - value + 1 : 1;
+				if (count > 1 && (filesystem.version != VOLUME_VERSION_EXTENT || count > maxRefs)) {
+					snprintf(line, sizeof(line), "blok %u dirujuk %u file", position, count);
+					problem(line, false);
+					continue;
+				}
+				if (stored == count) {
+					snprintf(line, sizeof(line), "blok data %u berisi pointer rantai %u", position, value);
+				}
+				else {
+					snprintf(line, sizeof(line), "blok %u: jumlah referensi %u, seharusnya %u", position, stored, count);
+				}
+				messages.push_back(line);
+				fixed = expected;
+			}
+		}
+
+		if (fixed != value && fixTable) {
+			Fix fix = {position, fixed};
+			found.push_back(fix);
+			value = fixed;
+		}
+		if (value == EMPTY_BLOCK) {
+			freeCount++;
+			first = min(first, position);
+		}
+	}
+
+	MutexGuard guard(lock);
+	for (size_t j = 0; j < messages.size(); j++) {
+		problem(messages[j], true);
+	}
+	fixes.insert(fixes.end(), found.begin(), found.end());
+	freeBlocks += freeCount;
+	firstFree = min(firstFree, first);
+}
+
+/**
+ * Mencatat satu kesalahan
+ * @param message    isi pesan
+ * @param repairable kesalahan penghitungan blok yang bisa diperbaiki
+ */
+void Checker::problem(const string &message, bool repairable) {
+	MutexGuard guard(lock);
+	problems.push_back(message);
+	if (repairable) {
+		accounting++;
+	}
+	else {
+		structural++;
+	}
+}
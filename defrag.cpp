@@ -0,0 +1,374 @@
+//////////////////////////////////
+// File defrag.cpp              //
+// Defragmentasi online         //
+//////////////////////////////////
+
+#include <climits>
+#include <cstdio>
+#include <time.h>
+#include "poi.hpp"
+
+/* Global filesystem */
+extern POI filesystem;
+
+/*
+ * Skor fragmentasi 0-100: jumlah sambungan blok file yang tidak
+ * berurutan ditambah blok direktori yang berlebih (dibanding jumlah
+ * minimum untuk entry-nya), dibagi seluruh blok file dan direktori.
+ * Volume yang semua file-nya berurutan dan direktorinya padat bernilai 0.
+ */
+
+/**
+ * Konstruktor, defragmentasi belum berjalan
+ */
+Defragmenter::Defragmenter() {
+	enabled = false;
+	rate = 0;
+	interval = DEFRAG_INTERVAL;
+	stopping = false;
+	scoreBefore = 0;
+	scoreAfter = 0;
+	passes = 0;
+	filesMoved = 0;
+	blocksMoved = 0;
+	directoryBlocksFreed = 0;
+	running = false;
+	started = 0;
+	moved = 0;
+}
+
+/**
+ * Menjalankan thread latar belakang: satu putaran segera, lalu setiap
+ * interval detik
+ */
+void Defragmenter::start() {
+	stopping = false;
+	running = pthread_create(&thread, NULL, run, this) == 0;
+}
+
+/**
+ * Menghentikan thread, putaran yang berjalan berhenti setelah file
+ * atau direktori yang sedang dikerjakan
+ */
+void Defragmenter::stop() {
+	if (!running) {
+		return;
+	}
+	stopping = true;
+	pthread_join(thread, NULL);
+	running = false;
+}
+
+/**
+ * Isi thread latar belakang
+ */
+void *Defragmenter::run(void *arg) {
+	Defragmenter *self = (Defragmenter*)arg;
+	while (!self->stopping) {
+		self->pass();
+		self->sleep(self->interval);
+	}
+	return NULL;
+}
+
+/**
+ * Satu putaran: setiap direktori dipadatkan lalu file di dalamnya yang
+ * terpecah dipindah ke satu deret blok, dari root ke bawah (BFS).
+ * Lock hanya dipegang selama satu file atau satu direktori.
+ */
+void Defragmenter::pass() {
+	started = Stats::now();
+	moved = 0;
+	filesMoved = 0;
+	blocksMoved = 0;
+	directoryBlocksFreed = 0;
+	scoreBefore = measure();
+
+	vector<string> directories(1, "/");
+	for (size_t i = 0; i < directories.size() && !stopping; i++) {
+		/* salinan, directories bertambah selama listDirectory */
+		string path = directories[i];
+		directoryBlocksFreed += compactDirectory(path);
+
+		vector<string> files;
+		listDirectory(path, files, directories);
+		for (size_t j = 0; j < files.size() && !stopping; j++) {
+			Block blocks = relocateFile(files[j]);
+			if (blocks > 0) {
+				filesMoved++;
+				blocksMoved += blocks;
+				throttle(blocks);
+			}
+		}
+	}
+
+	scoreAfter = measure();
+	passes++;
+}
+
+/**
+ * Hasil putaran terakhir untuk file statistik
+ * @return satu baris, kosong jika belum pernah berjalan
+ */
+string Defragmenter::report() {
+	if (passes == 0) {
+		return "";
+	}
+	char line[256];
+	snprintf(line, sizeof(line),
+		"defrag passes=%lu score_before=%.2f score_after=%.2f files_moved=%lu blocks_moved=%lu dir_blocks_freed=%lu\n",
+		passes, scoreBefore, scoreAfter, filesMoved, blocksMoved, directoryBlocksFreed);
+	return line;
+}
+
+/**
+ * Menghitung skor fragmentasi seluruh volume
+ * @return 0-100
+ */
+double Defragmenter::measure() {
+	unsigned long long blocks = 0;
+	unsigned long long gaps = 0;
+
+	vector<string> directories(1, "/");
+	for (size_t i = 0; i < directories.size(); i++) {
+		RWGuard guard(filesystem.namespaceLock, false);
+		Directory directory;
+		if (!openDirectory(directories[i], directory)) {
+			continue;
+		}
+		Block used, minimum;
+		directory.usage(used, minimum);
+		blocks += used;
+		gaps += used - min(used, minimum);
+
+		vector<Entry> entries = directory.list();
+		for (size_t j = 0; j < entries.size(); j++) {
+			Entry &entry = entries[j];
+			if (entry.getAttr() & 0x8) {
+				directories.push_back(childPath(directories[i], entry.getName()));
+				continue;
+			}
+			if (filesystem.isInline(entry)) {
+				continue;
+			}
+
+			if (filesystem.version == VOLUME_VERSION_EXTENT) {
+				ExtentList extents;
+				extents.load(entry);
+				for (size_t k = 0; k < extents.extents.size(); k++) {
+					blocks += extents.extents[k].length;
+					if (k > 0 && extents.extents[k].start != extents.extents[k - 1].start + extents.extents[k - 1].length) {
+						gaps++;
+					}
+				}
+				continue;
+			}
+			for (Block position = entry.getIndex(); position != END_BLOCK; position = filesystem.nextBlock[position]) {
+				Block next = filesystem.nextBlock[position];
+				blocks++;
+				if (next != END_BLOCK && next != position + 1) {
+					gaps++;
+				}
+			}
+		}
+	}
+	return blocks > 0 ? 100.0 * gaps / blocks : 0;
+}
+
+/**
+ * Memindah isi file yang terpecah ke satu deret blok berurutan. Isi
+ * disalin dulu, lalu rantai atau extent dan entry diganti dalam satu
+ * transaksi; blok lama baru bisa dipakai ulang setelah commit.
+ * @param  path path file
+ * @return      jumlah blok yang dipindah, 0 jika file dilewati
+ */
+Block Defragmenter::relocateFile(const string &path) {
+	/* seperti penulisan: file lain dan baca/tulis file lain tetap berjalan */
+	RWGuard guard(filesystem.namespaceLock, false);
+	Transaction transaction;
+	Entry entry = filesystem.lookup(path.c_str());
+	if (entry.isEmpty() || (entry.getAttr() & 0x8) || filesystem.isInline(entry)) {
+		return 0;
+	}
+	FileLock lock(entry, true);
+	entry = Entry(entry.position, entry.offset);
+
+	/* blok file sesuai urutan logis */
+	vector<Block> blocks;
+	ExtentList extents;
+	if (filesystem.version == VOLUME_VERSION_EXTENT) {
+		extents.load(entry);
+		for (size_t i = 0; i < extents.extents.size(); i++) {
+			for (Block j = 0; j < extents.extents[i].length; j++) {
+				blocks.push_back(extents.extents[i].start + j);
+			}
+		}
+	}
+	else {
+		for (Block position = entry.getIndex(); position != END_BLOCK; position = filesystem.nextBlock[position]) {
+			blocks.push_back(position);
+		}
+	}
+
+	bool contiguous = true;
+	for (size_t i = 1; i < blocks.size() && contiguous; i++) {
+		contiguous = blocks[i] == blocks[i - 1] + 1;
+	}
+	if (contiguous || blocks.size() > INT_MAX) {
+		return 0;
+	}
+
+	/* blok yang dipakai bersama (copy-on-write) tidak dipindah */
+	for (size_t i = 0; i < blocks.size() && filesystem.sharedBlocks > 0; i++) {
+		if (filesystem.refCount(blocks[i]) > 1) {
+			return 0;
+		}
+	}
+
+	/* hanya jika ada satu deret kosong yang cukup */
+	int length = blocks.size();
+	Block start;
+	{
+		MutexGuard meta(filesystem.metaLock);
+		if (filesystem.allocator.longestRun(length) < length) {
+			return 0;
+		}
+		start = filesystem.allocateRun(length);
+	}
+
+	int blockSize = filesystem.blockSize;
+	int chunk = max(1, DEFRAG_CHUNK / blockSize);
+	vector<char> buffer((size_t)chunk * blockSize);
+	for (int i = 0; i < length; i += chunk) {
+		int count = min(chunk, length - i);
+		vector<PoolRequest> reads, writes;
+		for (int j = 0; j < count; j++) {
+			PoolRequest read = {blocks[i + j], 0, &buffer[(size_t)j * blockSize], blockSize};
+			PoolRequest write = {start + i + j, 0, &buffer[(size_t)j * blockSize], blockSize};
+			reads.push_back(read);
+			writes.push_back(write);
+		}
+		filesystem.readPools(reads);
+		filesystem.writePools(writes);
+	}
+
+	if (filesystem.version == VOLUME_VERSION_EXTENT) {
+		ExtentList relocated;
+		for (int i = 0; i < length; i++) {
+			relocated.append(start + i);
+		}
+		relocated.store(entry);
+		for (size_t i = 0; i < extents.extents.size(); i++) {
+			filesystem.freeRange(extents.extents[i].start, extents.extents[i].length);
+		}
+		filesystem.extentGeneration++;
+		entry.write();
+	}
+	else {
+		for (int i = 0; i < length - 1; i++) {
+			filesystem.setNextBlock(start + i, start + i + 1);
+		}
+		Block first = entry.getIndex();
+		entry.setIndex(start);
+		entry.write();
+		filesystem.freeBlock(first);
+	}
+	return length;
+}
+
+/**
+ * Memadatkan satu direktori
+ * @param  path path direktori
+ * @return      jumlah blok yang dibebaskan
+ */
+Block Defragmenter::compactDirectory(const string &path) {
+	/* lokasi entry berubah, seperti rename */
+	RWGuard guard(filesystem.namespaceLock, true);
+	Transaction transaction;
+	Directory directory;
+	if (!openDirectory(path, directory)) {
+		return 0;
+	}
+	return directory.compact();
+}
+
+/**
+ * Daftar isi direktori
+ * @param path        path direktori
+ * @param files       path file ditambahkan ke sini
+ * @param directories path subdirektori ditambahkan ke sini
+ */
+void Defragmenter::listDirectory(const string &path, vector<string> &files, vector<string> &directories) {
+	RWGuard guard(filesystem.namespaceLock, false);
+	Directory directory;
+	if (!openDirectory(path, directory)) {
+		return;
+	}
+	vector<Entry> entries = directory.list();
+	for (size_t i = 0; i < entries.size(); i++) {
+		string child = childPath(path, entries[i].getName());
+		if (entries[i].getAttr() & 0x8) {
+			directories.push_back(child);
+		}
+		else {
+			files.push_back(child);
+		}
+	}
+}
+
+/**
+ * Membuka direktori dari path
+ * @param  path      path direktori
+ * @param  directory hasil
+ * @return           false jika path tidak ada atau bukan direktori
+ */
+bool Defragmenter::openDirectory(const string &path, Directory &directory) {
+	if (path == "/") {
+		directory = Directory::root();
+		return true;
+	}
+	Entry entry = filesystem.lookup(path.c_str());
+	if (entry.isEmpty() || !(entry.getAttr() & 0x8)) {
+		return false;
+	}
+	directory = Directory(entry);
+	return true;
+}
+
+/**
+ * Path entry di dalam direktori
+ */
+string Defragmenter::childPath(const string &parent, const string &name) {
+	return (parent == "/" ? "" : parent) + "/" + name;
+}
+
+/**
+ * Menahan putaran agar rata-rata pemindahan tidak melebihi rate
+ * @param blocks blok yang baru dipindah
+ */
+void Defragmenter::throttle(Block blocks) {
+	moved += (unsigned long long)blocks * filesystem.blockSize;
+	if (rate == 0) {
+		return;
+	}
+	double target = (double)moved / ((double)rate * 1024 * 1024);
+	double elapsed = (Stats::now() - started) / 1e9;
+	if (target > elapsed) {
+		sleep(target - elapsed);
+	}
+}
+
+/**
+ * Tidur, bangun setiap detik untuk memeriksa permintaan berhenti
+ * @param seconds
+ */
+void Defragmenter::sleep(double seconds) {
+	while (seconds > 0 && !stopping) {
+		double now = min(seconds, 1.0);
+		struct timespec ts;
+		ts.tv_sec = (time_t)now;
+		ts.tv_nsec = (long)((now - ts.tv_sec) * 1e9);
+		nanosleep(&ts, NULL);
+		seconds -= now;
+	}
+}
@@ -0,0 +1,269 @@
+////////////////////////////////
+// File dentry.cpp            //
+// Cache namespace (dentry)   //
+////////////////////////////////
+
+#include "poi.hpp"
+
+/* lokasi khusus untuk entry negatif (path tidak ada) */
+#define NEGATIVE_LOCATION 0xFFFFFFFFFFFFFFFFULL
+
+/**
+ * Konstruktor
+ */
+DentryCache::DentryCache() {
+	capacity = DENTRY_CAPACITY;
+	hits = 0;
+	negativeHits = 0;
+	misses = 0;
+	evictions = 0;
+}
+
+/**
+ * Mengatur jumlah kunci maksimum, 0 berarti cache mati
+ * @param capacity jumlah kunci
+ */
+void DentryCache::setCapacity(unsigned int capacity) {
+	MutexGuard guard(lock);
+	this->capacity = capacity;
+	while (keys.size() > capacity) {
+		erase(keys.find(lru.back()));
+		evictions++;
+	}
+}
+
+/**
+ * Mencari entry berdasarkan path penuh
+ * @param  path  path absolut
+ * @param  entry hasil, Entry kosong jika path tercatat tidak ada
+ * @return       true jika path ada di cache
+ */
+bool DentryCache::get(const string &path, Entry &entry) {
+	MutexGuard guard(lock);
+	return find(path, entry);
+}
+
+/**
+ * Mencari entry berdasarkan blok direktori parent dan nama
+ * @param  parent blok pertama direktori parent
+ * @param  name   nama entry
+ * @param  entry  hasil
+ * @return        true jika ada di cache
+ */
+bool DentryCache::get(Block parent, const string &name, Entry &entry) {
+	MutexGuard guard(lock);
+	return find(childKey(parent, name), entry);
+}
+
+/**
+ * Menyimpan hasil lookup positif
+ * @param path   path absolut
+ * @param parent blok pertama direktori parent
+ * @param entry  entry hasil lookup
+ */
+void DentryCache::put(const string &path, Block parent, const Entry &entry) {
+	MutexGuard guard(lock);
+	unsigned long long location = locationOf(entry.position, entry.offset);
+	string key = childKey(parent, keyName(path));
+	insert(path, location, entry.data);
+	insert(key, location, entry.data);
+
+	unordered_map<unsigned long long, Node>::iterator node = nodes.find(location);
+	if (node != nodes.end()) {
+		node->second.childKey = key;
+	}
+}
+
+/**
+ * Menyimpan hasil lookup negatif
+ * @param path path absolut yang tidak ada
+ */
+void DentryCache::putNegative(const string &path) {
+	MutexGuard guard(lock);
+	insert(path, NEGATIVE_LOCATION, NULL);
+}
+
+/**
+ * Menyalin isi entry yang baru ditulis ke cache, dipanggil oleh Entry::write
+ * @param entry entry yang ditulis
+ */
+void DentryCache::update(const Entry &entry) {
+	MutexGuard guard(lock);
+	unordered_map<unsigned long long, Node>::iterator node = nodes.find(locationOf(entry.position, entry.offset));
+	if (node != nodes.end()) {
+		memcpy(node->second.data, entry.data, ENTRY_MAX_SIZE);
+	}
+}
+
+/**
+ * Menghapus path (dan kunci parent-nya) dari cache
+ * @param path path absolut
+ */
+void DentryCache::invalidate(const string &path) {
+	MutexGuard guard(lock);
+	unordered_map<string, Key>::iterator it = keys.find(path);
+	if (it == keys.end()) {
+		return;
+	}
+
+	if (it->second.location != NEGATIVE_LOCATION) {
+		string key = nodes[it->second.location].childKey;
+		unordered_map<string, Key>::iterator child = keys.find(key);
+		if (child != keys.end()) {
+			erase(child);
+		}
+		it = keys.find(path);
+	}
+	erase(it);
+}
+
+static bool hasPrefix(const string &key, const string &prefix) {
+	return key.compare(0, prefix.length(), prefix) == 0;
+}
+
+/**
+ * Menghapus semua path di bawah sebuah direktori
+ * kunci parent tetap valid karena blok direktori tidak berubah
+ * @param path path direktori
+ */
+void DentryCache::invalidateTree(const string &path) {
+	MutexGuard guard(lock);
+	eraseIf(hasPrefix, path + "/");
+}
+
+/**
+ * Menghapus semua kunci parent milik direktori yang bloknya dibebaskan
+ * @param index blok pertama direktori
+ */
+void DentryCache::invalidateDirectory(Block index) {
+	MutexGuard guard(lock);
+	eraseIf(hasPrefix, childKey(index, ""));
+}
+
+/**
+ * Mengosongkan cache
+ */
+void DentryCache::clear() {
+	MutexGuard guard(lock);
+	keys.clear();
+	nodes.clear();
+	lru.clear();
+}
+
+/**
+ * Lokasi entry (blok, offset) sebagai satu bilangan
+ */
+unsigned long long DentryCache::locationOf(Block position, unsigned short offset) {
+	return ((unsigned long long)position << 16) | offset;
+}
+
+/**
+ * Kunci pasangan (parent, nama), tidak pernah bentrok dengan path
+ * karena path selalu diawali '/'
+ */
+string DentryCache::childKey(Block parent, const string &name) {
+	return to_string(parent) + ":" + name;
+}
+
+/**
+ * Nama komponen terakhir dari sebuah kunci
+ */
+string DentryCache::keyName(const string &key) {
+	if (key[0] == '/') {
+		return key.substr(key.rfind('/') + 1);
+	}
+	return key.substr(key.find(':') + 1);
+}
+
+/**
+ * Pencarian kunci; entry yang slotnya sudah dikosongkan atau dipakai
+ * nama lain dianggap miss dan dibuang
+ */
+bool DentryCache::find(const string &key, Entry &entry) {
+	unordered_map<string, Key>::iterator it = keys.find(key);
+	if (it == keys.end()) {
+		misses++;
+		return false;
+	}
+
+	/* pindahkan ke depan LRU */
+	lru.splice(lru.begin(), lru, it->second.lru);
+
+	if (it->second.location == NEGATIVE_LOCATION) {
+		negativeHits++;
+		entry = Entry();
+		return true;
+	}
+
+	Node &node = nodes[it->second.location];
+	if (node.data[0] == 0 || string(node.data) != keyName(key)) {
+		erase(it);
+		misses++;
+		return false;
+	}
+
+	hits++;
+	entry.position = it->second.location >> 16;
+	entry.offset = it->second.location & 0xFFFF;
+	memcpy(entry.data, node.data, ENTRY_MAX_SIZE);
+	return true;
+}
+
+/**
+ * Menambahkan atau mengganti kunci
+ */
+void DentryCache::insert(const string &key, unsigned long long location, const char *data) {
+	if (capacity == 0) {
+		return;
+	}
+
+	unordered_map<string, Key>::iterator it = keys.find(key);
+	if (it != keys.end()) {
+		erase(it);
+	}
+
+	if (location != NEGATIVE_LOCATION) {
+		Node &node = nodes[location];
+		memcpy(node.data, data, ENTRY_MAX_SIZE);
+		node.refs++;
+	}
+
+	lru.push_front(key);
+	Key value;
+	value.location = location;
+	value.lru = lru.begin();
+	keys[key] = value;
+
+	while (keys.size() > capacity) {
+		erase(keys.find(lru.back()));
+		evictions++;
+	}
+}
+
+/**
+ * Menghapus satu kunci beserta node-nya jika tidak dipakai lagi
+ */
+void DentryCache::erase(unordered_map<string, Key>::iterator it) {
+	unsigned long long location = it->second.location;
+	if (location != NEGATIVE_LOCATION) {
+		unordered_map<unsigned long long, Node>::iterator node = nodes.find(location);
+		if (node != nodes.end() && --node->second.refs == 0) {
+			nodes.erase(node);
+		}
+	}
+	lru.erase(it->second.lru);
+	keys.erase(it);
+}
+
+/**
+ * Menghapus semua kunci yang cocok dengan predikat
+ */
+void DentryCache::eraseIf(bool (*match)(const string &key, const string &prefix), const string &prefix) {
+	unordered_map<string, Key>::iterator it = keys.begin();
+	while (it != keys.end()) {
+		unordered_map<string, Key>::iterator current = it++;
+		if (match(current->first, prefix)) {
+			erase(current);
+		}
+	}
+}
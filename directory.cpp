@@ -0,0 +1,523 @@
+//////////////////////////////////
+// File directory.cpp           //
+// Isi direktori linear/hashed  //
+//////////////////////////////////
+
+#include "poi.hpp"
+
+/* Global filesystem */
+extern POI filesystem;
+
+/**
+ * Konstruktor default, menunjuk root
+ */
+Directory::Directory() {
+	index = 0;
+	hashed = false;
+	isRoot = true;
+}
+
+/**
+ * Konstruktor dari blok index
+ * @param index  blok pertama direktori
+ * @param hashed format direktori
+ */
+Directory::Directory(Block index, bool hashed) {
+	this->index = index;
+	this->hashed = hashed;
+	isRoot = false;
+}
+
+/**
+ * Konstruktor dari entry pemilik direktori
+ * @param owner entry direktori
+ */
+Directory::Directory(const Entry &owner) {
+	this->owner = owner;
+	index = this->owner.getIndex();
+	hashed = (this->owner.getAttr() & ATTR_HASHED) != 0;
+	isRoot = false;
+}
+
+/**
+ * Direktori root, selalu di blok 0
+ * @return
+ */
+Directory Directory::root() {
+	Directory result(0, (filesystem.flags & VOLUME_HASHED_ROOT) != 0);
+	result.isRoot = true;
+	return result;
+}
+
+/**
+ * Membuat direktori baru yang masih kosong
+ * @param  hashed format direktori
+ * @return        blok index direktori
+ */
+Block Directory::create(bool hashed) {
+	return newBlock(hashed ? 0xFF : 0x00);
+}
+
+/**
+ * Mencari entry dengan nama tertentu
+ * @param  name nama entry
+ * @return      Entry kosong jika tidak ditemukan
+ */
+Entry Directory::find(const string &name) {
+	Entry result;
+	Block last;
+	int length;
+
+	Block position = index;
+	if (hashed) {
+		position = bucketHead(hash(name) % bucketCount());
+	}
+	if (scanChain(position, &name, result, last, length)) {
+		return result;
+	}
+	return Entry();
+}
+
+/**
+ * Mendapatkan slot kosong untuk entry baru bernama name,
+ * direktori diperbesar jika perlu. Slot belum ditulis.
+ * @param  name nama entry baru
+ * @return
+ */
+Entry Directory::emptySlot(const string &name) {
+	Entry result = emptySlot(name, true);
+
+	/* slot bekas entry yang dihapus masih berisi data lama */
+	memset(result.data, 0, ENTRY_MAX_SIZE);
+	return result;
+}
+
+/**
+ * Mendapatkan semua entry yang tidak kosong
+ * @return
+ */
+vector<Entry> Directory::list() {
+	vector<Entry> result;
+	if (!hashed) {
+		listChain(index, result);
+		return result;
+	}
+
+	/* baca tabel bucket per blok */
+	Block table = index;
+	vector<char> heads(filesystem.blockSize);
+	while (table != END_BLOCK) {
+		filesystem.readBlock(table, &heads[0], filesystem.blockSize);
+		for (int i = 0; i < filesystem.pointerPerBlock; i++) {
+			listChain(filesystem.getPointer(&heads[i * filesystem.pointerWidth]), result);
+		}
+		table = filesystem.nextBlock[table];
+	}
+	return result;
+}
+
+/**
+ * Mendapatkan entry tidak kosong mulai dari sebuah posisi slot, dibaca
+ * per blok entry sampai paling sedikit limit entry didapat. Posisi slot
+ * adalah (bucket << 32) | nomor slot di rantai bucket, 0 untuk awal
+ * direktori; posisi tetap berlaku selama rantai tidak dipadatkan.
+ * @param  cursor posisi slot pertama yang dibaca
+ * @param  limit  jumlah entry minimum
+ * @param  result entry yang didapat
+ * @param  next   posisi slot sesudah setiap entry di result
+ * @return        false jika akhir direktori tercapai
+ */
+bool Directory::list(off_t cursor, size_t limit, vector<Entry> &result, vector<off_t> &next) {
+	int buckets = hashed ? bucketCount() : 1;
+	int bucket = (int)(cursor >> 32);
+	Block slot = (Block)(cursor & 0xFFFFFFFF);
+	vector<char> buffer(filesystem.blockSize);
+
+	for (; bucket < buckets; bucket++, slot = 0) {
+		/* lewati blok di depan slot lewat allocation table saja */
+		Block position = hashed ? bucketHead(bucket) : index;
+		Block base = 0;
+		while (position != END_BLOCK && base + filesystem.entryPerBlock <= slot) {
+			position = filesystem.nextBlock[position];
+			base += filesystem.entryPerBlock;
+		}
+
+		while (position != END_BLOCK) {
+			const char *data = readEntryBlock(position, &buffer[0]);
+			for (int i = slot - base; i < filesystem.entryPerBlock; i++) {
+				Entry entry(position, i, data + i * filesystem.entrySize);
+				if (!entry.isEmpty()) {
+					result.push_back(entry);
+					next.push_back(((off_t)bucket << 32) | (base + i + 1));
+				}
+			}
+			base += filesystem.entryPerBlock;
+			slot = base;
+			position = filesystem.nextBlock[position];
+			if (result.size() >= limit) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+/**
+ * Membebaskan semua blok direktori
+ */
+void Directory::release() {
+	if (hashed) {
+		int buckets = bucketCount();
+		for (int i = 0; i < buckets; i++) {
+			Block head = bucketHead(i);
+			if (head != END_BLOCK) {
+				filesystem.freeBlock(head);
+			}
+		}
+	}
+	filesystem.freeBlock(index);
+}
+
+/**
+ * Blok entry yang dipakai direktori (tanpa tabel bucket) dan jumlah
+ * minimum jika semua entry dipadatkan
+ * @param blocks  blok entry
+ * @param minimum blok minimum
+ */
+void Directory::usage(Block &blocks, Block &minimum) {
+	blocks = 0;
+	minimum = 0;
+	int buckets = hashed ? bucketCount() : 1;
+	for (int i = 0; i < buckets; i++) {
+		Block head = hashed ? bucketHead(i) : index;
+		vector<Entry> entries;
+		listChain(head, entries);
+		for (Block position = head; position != END_BLOCK; position = filesystem.nextBlock[position]) {
+			blocks++;
+		}
+		minimum += (entries.size() + filesystem.entryPerBlock - 1) / filesystem.entryPerBlock;
+	}
+	/* direktori linear selalu memiliki blok index */
+	if (!hashed && minimum == 0) {
+		minimum = 1;
+	}
+}
+
+/**
+ * Memadatkan direktori: entry digeser ke slot kosong paling depan pada
+ * rantainya, blok entry di belakang yang tidak terpakai dibebaskan.
+ * Dipanggil dengan namespaceLock eksklusif.
+ * @return jumlah blok yang dibebaskan
+ */
+Block Directory::compact() {
+	if (!hashed) {
+		return compactChain(index);
+	}
+	Block freed = 0;
+	int buckets = bucketCount();
+	for (int i = 0; i < buckets; i++) {
+		Block head = bucketHead(i);
+		if (head == END_BLOCK) {
+			continue;
+		}
+		freed += compactChain(head);
+
+		/* bucket yang menjadi kosong dilepas seluruhnya */
+		Entry first(head, 0);
+		if (first.isEmpty()) {
+			setBucketHead(i, END_BLOCK);
+			filesystem.freeBlock(head);
+			freed++;
+		}
+	}
+	return freed;
+}
+
+/**
+ * Fungsi hash nama (FNV-1a)
+ */
+unsigned int Directory::hash(const string &name) {
+	unsigned int result = 2166136261u;
+	for (unsigned int i = 0; i < name.length(); i++) {
+		result ^= (unsigned char)name[i];
+		result *= 16777619u;
+	}
+	return result;
+}
+
+/**
+ * Mengalokasikan blok baru yang seluruh isinya fill
+ * @param  fill 0x00 untuk blok entry, 0xFF untuk tabel bucket
+ * @param  hint blok yang diinginkan, agar rantai direktori berurutan
+ * @return
+ */
+Block Directory::newBlock(unsigned char fill, Block hint) {
+	vector<char> buffer(filesystem.blockSize, fill);
+
+	Block result = filesystem.allocateBlock(hint);
+	filesystem.writeMetadata(result, 0, &buffer[0], filesystem.blockSize);
+	return result;
+}
+
+/**
+ * Jumlah bucket, dari panjang rantai tabel di allocation table
+ */
+int Directory::bucketCount() {
+	int result = 0;
+	for (Block table = index; table != END_BLOCK; table = filesystem.nextBlock[table]) {
+		result += filesystem.pointerPerBlock;
+	}
+	return result;
+}
+
+/**
+ * Blok tabel yang menyimpan pointer sebuah bucket
+ */
+Block Directory::tableBlock(int bucket) {
+	Block table = index;
+	for (int i = bucket / filesystem.pointerPerBlock; i > 0; i--) {
+		table = filesystem.nextBlock[table];
+	}
+	return table;
+}
+
+/**
+ * Blok pertama sebuah bucket, END_BLOCK jika bucket kosong
+ */
+Block Directory::bucketHead(int bucket) {
+	char head[sizeof(Block)];
+	int offset = (bucket % filesystem.pointerPerBlock) * filesystem.pointerWidth;
+	filesystem.readBlock(tableBlock(bucket), head, filesystem.pointerWidth, offset);
+	return filesystem.getPointer(head);
+}
+
+/**
+ * Mengatur blok pertama sebuah bucket
+ */
+void Directory::setBucketHead(int bucket, Block head) {
+	char data[sizeof(Block)];
+	int offset = (bucket % filesystem.pointerPerBlock) * filesystem.pointerWidth;
+	filesystem.setPointer(data, head);
+	filesystem.writeMetadata(tableBlock(bucket), offset, data, filesystem.pointerWidth);
+}
+
+/**
+ * Isi satu blok entry; pada backend mmap langsung menunjuk ke pemetaan
+ * @param  position blok
+ * @param  buffer   buffer sebesar satu blok jika harus dibaca
+ * @return
+ */
+const char *Directory::readEntryBlock(Block position, char *buffer) {
+	const char *mapped = filesystem.blockPointer(position);
+	if (mapped != NULL) {
+		return mapped;
+	}
+	filesystem.readBlock(position, buffer, filesystem.blockSize);
+	return buffer;
+}
+
+/**
+ * Menelusuri rantai blok entry, satu kali baca per blok
+ * @param  position blok pertama rantai
+ * @param  name     nama yang dicari, NULL untuk mencari slot kosong
+ * @param  result   entry yang ditemukan
+ * @param  last     blok terakhir rantai (jika tidak ditemukan)
+ * @param  length   jumlah blok yang ditelusuri
+ * @return          true jika ditemukan
+ */
+bool Directory::scanChain(Block position, const string *name, Entry &result, Block &last, int &length) {
+	vector<char> buffer(filesystem.blockSize);
+	last = END_BLOCK;
+	length = 0;
+
+	while (position != END_BLOCK) {
+		const char *data = readEntryBlock(position, &buffer[0]);
+		for (int i = 0; i < filesystem.entryPerBlock; i++) {
+			Entry entry(position, i, data + i * filesystem.entrySize);
+			if (name == NULL ? entry.isEmpty() : (!entry.isEmpty() && entry.getName() == *name)) {
+				result = entry;
+				return true;
+			}
+		}
+		last = position;
+		length++;
+		position = filesystem.nextBlock[position];
+	}
+	return false;
+}
+
+/**
+ * Menambahkan semua entry tidak kosong pada rantai ke result
+ */
+void Directory::listChain(Block position, vector<Entry> &result) {
+	vector<char> buffer(filesystem.blockSize);
+	while (position != END_BLOCK) {
+		const char *data = readEntryBlock(position, &buffer[0]);
+		for (int i = 0; i < filesystem.entryPerBlock; i++) {
+			Entry entry(position, i, data + i * filesystem.entrySize);
+			if (!entry.isEmpty()) {
+				result.push_back(entry);
+			}
+		}
+		position = filesystem.nextBlock[position];
+	}
+}
+
+/**
+ * Memadatkan satu rantai blok entry, urutan entry dipertahankan.
+ * Handle file yang terbuka ikut pindah ke slot baru.
+ * @param  head blok pertama rantai, tidak pernah dibebaskan
+ * @return      jumlah blok yang dibebaskan
+ */
+Block Directory::compactChain(Block head) {
+	vector<Entry> entries;
+	listChain(head, entries);
+
+	/* slot ke-i rantai ada di blok ke-(i / entryPerBlock) */
+	vector<Block> blocks;
+	for (Block position = head; position != END_BLOCK; position = filesystem.nextBlock[position]) {
+		blocks.push_back(position);
+	}
+
+	bool moved = false;
+	for (unsigned int i = 0; i < entries.size(); i++) {
+		Block position = blocks[i / filesystem.entryPerBlock];
+		int offset = i % filesystem.entryPerBlock;
+		if (entries[i].position == position && entries[i].offset == offset) {
+			continue;
+		}
+
+		/* slot tujuan selalu di depan entry, sudah kosong */
+		vector<FileHandle*> detached = filesystem.handles.detach(entries[i]);
+		Entry slot(position, offset, entries[i].data);
+		slot.write();
+		entries[i].makeEmpty();
+		filesystem.handles.attach(detached, slot);
+		moved = true;
+	}
+	if (moved) {
+		filesystem.dentry.clear();
+	}
+
+	/* bebaskan blok di belakang entry terakhir */
+	Block keep = (entries.size() + filesystem.entryPerBlock - 1) / filesystem.entryPerBlock;
+	keep = max(keep, (Block)1);
+	if (blocks.size() <= keep) {
+		return 0;
+	}
+	filesystem.freeBlock(blocks[keep]);
+	filesystem.setNextBlock(blocks[keep - 1], END_BLOCK);
+	return blocks.size() - keep;
+}
+
+/**
+ * Mendapatkan slot kosong
+ * @param  name nama entry baru
+ * @param  grow boleh mengubah format/ukuran tabel
+ * @return
+ */
+Entry Directory::emptySlot(const string &name, bool grow) {
+	Entry result;
+	Block last;
+	int length;
+
+	/* direktori linear: upgrade ke hashed jika sudah besar */
+	if (!hashed) {
+		if (scanChain(index, NULL, result, last, length)) {
+			return result;
+		}
+		if (grow && (filesystem.flags & VOLUME_HASHED_DIRS) && length >= HASH_UPGRADE_BLOCKS) {
+			rebuild(filesystem.pointerPerBlock);
+			return emptySlot(name, false);
+		}
+		Block position = newBlock(0x00, last + 1);
+		filesystem.setNextBlock(last, position);
+		return Entry(position, 0);
+	}
+
+	/* direktori hashed: cari di bucket */
+	int buckets = bucketCount();
+	int bucket = hash(name) % buckets;
+	Block head = bucketHead(bucket);
+	if (head == END_BLOCK) {
+		head = newBlock(0x00);
+		setBucketHead(bucket, head);
+		return Entry(head, 0);
+	}
+	if (scanChain(head, NULL, result, last, length)) {
+		return result;
+	}
+
+	/* bucket penuh, perbesar tabel jika rantai sudah panjang */
+	if (grow && length >= HASH_MAX_CHAIN && buckets < HASH_MAX_TABLE_BLOCKS * filesystem.pointerPerBlock) {
+		rebuild(buckets * 2);
+		return emptySlot(name, false);
+	}
+	Block position = newBlock(0x00, last + 1);
+	filesystem.setNextBlock(last, position);
+	return Entry(position, 0);
+}
+
+/**
+ * Menyusun ulang direktori menjadi tabel hashed dengan jumlah bucket
+ * tertentu. Blok index tetap, sehingga entry pemilik hanya perlu
+ * ditandai hashed.
+ * @param buckets jumlah bucket baru (kelipatan pointerPerBlock)
+ */
+void Directory::rebuild(int buckets) {
+	vector<Entry> entries = list();
+
+	/* bebaskan blok entry lama */
+	if (hashed) {
+		int oldBuckets = bucketCount();
+		for (int i = 0; i < oldBuckets; i++) {
+			Block head = bucketHead(i);
+			if (head != END_BLOCK) {
+				filesystem.freeBlock(head);
+			}
+		}
+	}
+	else {
+		filesystem.freeBlock(filesystem.nextBlock[index]);
+		filesystem.setNextBlock(index, END_BLOCK);
+	}
+
+	/* siapkan rantai tabel yang semua bucket-nya kosong */
+	vector<char> buffer(filesystem.blockSize, 0xFF);
+	Block table = index;
+	for (int i = buckets / filesystem.pointerPerBlock; i > 0; i--) {
+		filesystem.writeMetadata(table, 0, &buffer[0], filesystem.blockSize);
+		if (i > 1 && filesystem.nextBlock[table] == END_BLOCK) {
+			filesystem.setNextBlock(table, filesystem.allocateBlock(table + 1));
+		}
+		table = filesystem.nextBlock[table];
+	}
+
+	/* tandai direktori sebagai hashed */
+	if (!hashed) {
+		hashed = true;
+		if (isRoot) {
+			filesystem.flags |= VOLUME_HASHED_ROOT;
+			filesystem.writeVolumeInformation();
+		}
+		else {
+			owner.setAttr(owner.getAttr() | ATTR_HASHED);
+			owner.write();
+		}
+	}
+
+	/* masukkan kembali semua entry, handle file yang terbuka ikut pindah */
+	vector< vector<FileHandle*> > detached;
+	for (unsigned int i = 0; i < entries.size(); i++) {
+		detached.push_back(filesystem.handles.detach(entries[i]));
+	}
+	for (unsigned int i = 0; i < entries.size(); i++) {
+		Entry slot = emptySlot(entries[i].getName(), false);
+		memcpy(slot.data, entries[i].data, ENTRY_MAX_SIZE);
+		slot.write();
+		filesystem.handles.attach(detached[i], slot);
+	}
+
+	/* lokasi entry berubah */
+	filesystem.dentry.clear();
+}
@@ -0,0 +1,291 @@
+//////////////////////////////////
+// File extent.cpp              //
+// Daftar extent file (v2)      //
+//////////////////////////////////
+
+#include "poi.hpp"
+
+/* Global filesystem */
+extern POI filesystem;
+
+/**
+ * Membaca extent ke-i dari area extent di volume
+ */
+static Extent readExtent(const char *area, int i) {
+	Extent result;
+	int width = filesystem.pointerWidth;
+	result.start = filesystem.getPointer(area + i * 2 * width);
+	result.length = filesystem.getPointer(area + i * 2 * width + width);
+	return result;
+}
+
+/**
+ * Menulis extent ke-i ke area extent di volume
+ */
+static void writeExtent(char *area, int i, const Extent &extent) {
+	int width = filesystem.pointerWidth;
+	filesystem.setPointer(area + i * 2 * width, extent.start);
+	filesystem.setPointer(area + i * 2 * width + width, extent.length);
+}
+
+/**
+ * Jumlah extent dalam satu blok overflow
+ */
+static int extentPerBlock() {
+	return filesystem.pointerPerBlock / 2;
+}
+
+/**
+ * Panjang extent maksimum yang muat di pointer volume
+ */
+static Block extentLimit() {
+	return filesystem.pointerWidth == 2 ? 0xFFFE : END_BLOCK - 1;
+}
+
+/**
+ * Konstruktor
+ */
+ExtentList::ExtentList() {
+	generation = 0;
+	loaded = false;
+	firstDirty = 0;
+}
+
+/**
+ * Memuat extent dari entry: extent inline lalu rantai blok overflow
+ * yang ditunjuk index entry
+ * @param entry entry file
+ */
+void ExtentList::load(Entry &entry) {
+	extents.clear();
+	starts.clear();
+
+	/* isi file inline di entry, belum memiliki blok */
+	if (entry.getAttr() & ATTR_INLINE) {
+		generation = filesystem.extentGeneration;
+		loaded = true;
+		firstDirty = 0;
+		return;
+	}
+
+	Block count = 0;
+	for (int i = 0; i < EXTENT_INLINE_COUNT; i++) {
+		Extent extent = readExtent(entry.data + filesystem.entryBase, i);
+		if (extent.length == 0) {
+			break;
+		}
+		starts.push_back(count);
+		extents.push_back(extent);
+		count += extent.length;
+	}
+
+	/* extent sisanya ada di rantai overflow */
+	Block position = entry.getIndex();
+	bool full = extents.size() == EXTENT_INLINE_COUNT;
+	vector<char> buffer(filesystem.blockSize);
+	while (full && position != END_BLOCK) {
+		filesystem.readBlock(position, &buffer[0], filesystem.blockSize);
+		for (int i = 0; i < extentPerBlock(); i++) {
+			Extent extent = readExtent(&buffer[0], i);
+			if (extent.length == 0) {
+				full = false;
+				break;
+			}
+			starts.push_back(count);
+			extents.push_back(extent);
+			count += extent.length;
+		}
+		position = filesystem.nextBlock[position];
+	}
+
+	generation = filesystem.extentGeneration;
+	loaded = true;
+	firstDirty = extents.size();
+}
+
+/**
+ * Menyimpan extent ke entry, rantai overflow diperpanjang atau
+ * dipendekkan sesuai jumlah extent. Entry belum ditulis.
+ * @param entry entry file
+ */
+void ExtentList::store(Entry &entry) {
+	/* area inline selalu ditulis ulang */
+	char *inline_area = entry.data + filesystem.entryBase;
+	memset(inline_area, 0, EXTENT_INLINE_COUNT * 2 * filesystem.pointerWidth);
+	int count = min((int)extents.size(), EXTENT_INLINE_COUNT);
+	for (int i = 0; i < count; i++) {
+		writeExtent(inline_area, i, extents[i]);
+	}
+
+	int perBlock = extentPerBlock();
+	int overflow = (int)extents.size() - EXTENT_INLINE_COUNT;
+	int needed = overflow > 0 ? (overflow + perBlock - 1) / perBlock : 0;
+
+	Block previous = END_BLOCK;
+	Block position = entry.getIndex();
+	for (int i = 0; i < needed; i++) {
+		if (position == END_BLOCK) {
+			position = filesystem.allocateBlock();
+			if (previous == END_BLOCK) {
+				entry.setIndex(position);
+			}
+			else {
+				filesystem.setNextBlock(previous, position);
+			}
+		}
+
+		/* hanya blok yang berisi extent berubah yang ditulis */
+		int first = EXTENT_INLINE_COUNT + i * perBlock;
+		if (first + perBlock > firstDirty) {
+			vector<char> buffer(filesystem.blockSize, 0);
+			int n = min((int)extents.size() - first, perBlock);
+			for (int j = 0; j < n; j++) {
+				writeExtent(&buffer[0], j, extents[first + j]);
+			}
+			filesystem.writeMetadata(position, 0, &buffer[0], filesystem.blockSize);
+		}
+
+		previous = position;
+		position = filesystem.nextBlock[position];
+	}
+
+	/* bebaskan sisa rantai yang tidak dipakai lagi */
+	if (position != END_BLOCK) {
+		if (previous == END_BLOCK) {
+			entry.setIndex(END_BLOCK);
+		}
+		else {
+			filesystem.setNextBlock(previous, END_BLOCK);
+		}
+		filesystem.freeBlock(position);
+	}
+
+	firstDirty = extents.size();
+}
+
+/**
+ * Blok fisik dari blok logis file
+ * @param  block blok logis
+ * @return       END_BLOCK jika melewati akhir file
+ */
+Block ExtentList::map(Block block) {
+	if (block >= blocks()) {
+		return END_BLOCK;
+	}
+	int i = upper_bound(starts.begin(), starts.end(), block) - starts.begin() - 1;
+	return extents[i].start + (block - starts[i]);
+}
+
+/**
+ * Jumlah blok data file
+ */
+Block ExtentList::blocks() {
+	if (extents.empty()) {
+		return 0;
+	}
+	return starts.back() + extents.back().length;
+}
+
+/**
+ * Menambahkan satu blok di akhir file, extent terakhir diperpanjang
+ * jika blok bersebelahan
+ * @param position blok fisik
+ */
+void ExtentList::append(Block position) {
+	if (!extents.empty()) {
+		Extent &last = extents.back();
+		if (last.start + last.length == position && last.length < extentLimit()) {
+			last.length++;
+			firstDirty = min(firstDirty, (int)extents.size() - 1);
+			return;
+		}
+	}
+
+	Extent extent;
+	extent.start = position;
+	extent.length = 1;
+	starts.push_back(blocks());
+	extents.push_back(extent);
+	firstDirty = min(firstDirty, (int)extents.size() - 1);
+}
+
+/**
+ * Memendekkan file menjadi sejumlah blok, blok sisanya dibebaskan
+ * @param blocks jumlah blok yang dipertahankan
+ */
+void ExtentList::truncate(Block blocks) {
+	while (this->blocks() > blocks) {
+		Extent &last = extents.back();
+		Block excess = this->blocks() - blocks;
+		if (excess >= last.length) {
+			filesystem.freeRange(last.start, last.length);
+			extents.pop_back();
+			starts.pop_back();
+			firstDirty = min(firstDirty, (int)extents.size());
+		}
+		else {
+			last.length -= excess;
+			filesystem.freeRange(last.start + last.length, excess);
+			firstDirty = min(firstDirty, (int)extents.size() - 1);
+		}
+	}
+}
+
+/**
+ * Mengganti blok fisik satu blok logis (copy-on-write). Extent yang
+ * memuatnya dipecah, lalu digabung dengan tetangga yang bersambung
+ * agar penulisan ulang berurutan tetap menjadi sedikit extent.
+ * @param block    blok logis
+ * @param position blok fisik baru
+ */
+void ExtentList::replace(Block block, Block position) {
+	int i = upper_bound(starts.begin(), starts.end(), block) - starts.begin() - 1;
+	Extent old = extents[i];
+	Block k = block - starts[i];
+
+	vector<Extent> parts;
+	if (k > 0) {
+		Extent before = {old.start, k};
+		parts.push_back(before);
+	}
+	Extent replaced = {position, 1};
+	parts.push_back(replaced);
+	if (k + 1 < old.length) {
+		Extent after = {old.start + k + 1, old.length - k - 1};
+		parts.push_back(after);
+	}
+	extents.erase(extents.begin() + i);
+	extents.insert(extents.begin() + i, parts.begin(), parts.end());
+
+	int first = max(i - 1, 0);
+	int last = min(i + (int)parts.size(), (int)extents.size() - 1);
+	for (int j = last; j > first; j--) {
+		Extent &previous = extents[j - 1];
+		if (previous.start + previous.length == extents[j].start && previous.length + extents[j].length <= extentLimit()) {
+			previous.length += extents[j].length;
+			extents.erase(extents.begin() + j);
+		}
+	}
+
+	/* blok logis awal disusun ulang mulai dari extent yang berubah */
+	Block count = starts[first];
+	starts.resize(extents.size());
+	for (size_t j = first; j < extents.size(); j++) {
+		starts[j] = count;
+		count += extents[j].length;
+	}
+	firstDirty = min(firstDirty, first);
+}
+
+/**
+ * Menyalin daftar extent file lain untuk disimpan ke entry baru,
+ * seluruh rantai overflow ditulis oleh store
+ * @param other extent sumber
+ */
+void ExtentList::assign(const ExtentList &other) {
+	extents = other.extents;
+	starts = other.starts;
+	generation = other.generation;
+	loaded = true;
+	firstDirty = 0;
+}
@@ -0,0 +1,75 @@
+//////////////////////////////
+// Pemeriksa volume Poi-FS  //
+//////////////////////////////
+
+#include <iostream>
+#include <stdexcept>
+#include "poi.hpp"
+
+using namespace std;
+
+POI filesystem;
+
+/**
+ * Waktu sekarang dalam detik
+ */
+static double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		printf("Usage: ./poi-fsck <filesystem.poi> [-repair] [-threads=<n>] [-backend=stream|mmap]\n");
+		return FSCK_FAILED;
+	}
+
+	Checker checker;
+	bool repair = false;
+	for (int i = 2; i < argc; i++) {
+		string arg(argv[i]);
+		if (arg == "-repair") {
+			// blok bocor, jumlah referensi dan header ditulis ulang
+			repair = true;
+		}
+		else if (arg.compare(0, 9, "-threads=") == 0) {
+			checker.threads = max(atoi(argv[i] + 9), 1);
+		}
+		else if (arg == "-backend=mmap") {
+			filesystem.backend = BACKEND_MMAP;
+		}
+		else if (arg == "-backend=stream") {
+			filesystem.backend = BACKEND_STREAM;
+		}
+		else {
+			printf("Opsi tidak dikenal: %s\n", argv[i]);
+			return FSCK_FAILED;
+		}
+	}
+
+	// journal diputar ulang saat load, metadata lain tidak diubah
+	// kecuali dengan -repair
+	double start = now();
+	try {
+		filesystem.load(argv[1]);
+	}
+	catch (runtime_error &e) {
+		printf("%s: %s\n", argv[1], e.what());
+		return FSCK_FAILED;
+	}
+
+	// blok dibaca langsung agar thread pemeriksa tidak berebut cache
+	filesystem.cache.setBudget(0);
+	int result = checker.run(repair);
+
+	for (size_t i = 0; i < checker.problems.size(); i++) {
+		printf("%s\n", checker.problems[i].c_str());
+	}
+	printf("%s: %lu direktori, %lu file, %u/%u blok terpakai, %lu kesalahan struktur, %lu kesalahan penghitungan, %lu diperbaiki, %.2f detik\n",
+		argv[1], checker.directories, checker.files, filesystem.capacity - checker.freeBlocks, filesystem.capacity,
+		checker.structural, checker.accounting, checker.repaired, now() - start);
+
+	filesystem.close();
+	return result;
+}
@@ -0,0 +1,75 @@
+//////////////////////////////////
+// File handle.cpp              //
+// Daftar file yang dibuka      //
+//////////////////////////////////
+
+#include "poi.hpp"
+
+/**
+ * Membuat handle untuk entry yang dibuka
+ * @param  entry entry file
+ * @return
+ */
+FileHandle *HandleTable::open(const Entry &entry) {
+	MutexGuard guard(lock);
+	FileHandle *handle = new FileHandle();
+	handle->entry = entry;
+	handles.push_back(handle);
+	return handle;
+}
+
+/**
+ * Menutup handle
+ * @param handle
+ */
+void HandleTable::release(FileHandle *handle) {
+	MutexGuard guard(lock);
+	handles.remove(handle);
+	delete handle;
+}
+
+/**
+ * Menyalin isi entry yang baru ditulis ke handle yang menunjuk slot yang sama,
+ * entry yang dikosongkan (unlink) membuat handle tidak valid
+ * @param entry entry yang ditulis
+ */
+void HandleTable::update(const Entry &entry) {
+	MutexGuard guard(lock);
+	for (list<FileHandle*>::iterator it = handles.begin(); it != handles.end(); it++) {
+		Entry &current = (*it)->entry;
+		if (current.position == entry.position && current.offset == entry.offset) {
+			memcpy(current.data, entry.data, ENTRY_MAX_SIZE);
+		}
+	}
+}
+
+/**
+ * Melepas sementara handle yang menunjuk slot entry, dipakai sebelum
+ * entry dipindahkan agar penulisan slot lain tidak tercampur
+ * @param  entry slot lama
+ * @return       handle yang dilepas
+ */
+vector<FileHandle*> HandleTable::detach(const Entry &entry) {
+	MutexGuard guard(lock);
+	vector<FileHandle*> result;
+	for (list<FileHandle*>::iterator it = handles.begin(); it != handles.end(); it++) {
+		Entry &current = (*it)->entry;
+		if (current.position == entry.position && current.offset == entry.offset) {
+			current.position = END_BLOCK;
+			result.push_back(*it);
+		}
+	}
+	return result;
+}
+
+/**
+ * Memasang kembali handle ke slot baru entry
+ * @param detached hasil detach
+ * @param entry    slot baru
+ */
+void HandleTable::attach(const vector<FileHandle*> &detached, const Entry &entry) {
+	MutexGuard guard(lock);
+	for (unsigned int i = 0; i < detached.size(); i++) {
+		detached[i]->entry = entry;
+	}
+}
@@ -0,0 +1,389 @@
+//////////////////////////////////
+// File journal.cpp             //
+// Journal metadata (WAL)       //
+//////////////////////////////////
+
+#include <stdexcept>
+#include <time.h>
+#include "poi.hpp"
+
+/* Global filesystem */
+extern POI filesystem;
+
+/*
+ * Area journal: blok pertama adalah blok commit
+ *   0x00 "jrnl", 0x08 nomor transaksi, 0x10 panjang rekaman (0 = kosong),
+ *   0x18 checksum FNV-1a 64 bit seluruh rekaman
+ * diikuti rekaman berurutan mulai blok kedua:
+ *   posisi byte (8), ukuran (4), isi
+ * Blok commit dan rekaman ditulis dalam satu penulisan; transaksi yang
+ * terpotong gagal di checksum sehingga diabaikan saat load.
+ */
+
+/**
+ * Konstruktor, volume tanpa journal
+ */
+Journal::Journal() {
+	start = 0;
+	blocks = 0;
+	sequence = 0;
+	commits = 0;
+	overflows = 0;
+	replays = 0;
+	pendingSize = 0;
+	enabled = false;
+}
+
+/**
+ * Mengatur lokasi area journal dari Volume Information
+ * @param start  blok pertama, 0 jika volume tidak memiliki journal
+ * @param blocks panjang area
+ */
+void Journal::attach(Block start, Block blocks) {
+	this->start = start;
+	this->blocks = blocks;
+	if (start == 0 || blocks < 2) {
+		this->start = 0;
+		this->blocks = 0;
+	}
+}
+
+/**
+ * Mengaktifkan journal, metadata data pool ditahan sampai commit
+ * @param enabled
+ */
+void Journal::enable(bool enabled) {
+	this->enabled = enabled && start != 0;
+}
+
+/**
+ * Apakah perubahan metadata melalui journal
+ */
+bool Journal::active() {
+	return enabled;
+}
+
+/**
+ * Memutar ulang transaksi terakhir yang sudah commit; aman diulang
+ * karena isi rekaman selalu keadaan terbaru blok tersebut
+ * @return true jika ada transaksi yang diputar ulang
+ */
+bool Journal::replay() {
+	if (start == 0) {
+		return false;
+	}
+
+	char header[32];
+	off_t base = filesystem.blockOffset(start);
+	filesystem.storage->read(base, header, sizeof(header));
+	unsigned long long length, sum;
+	memcpy((char*)&length, header + 0x10, 8);
+	memcpy((char*)&sum, header + 0x18, 8);
+	if (string(header, 4) != "jrnl" || length == 0 || length > capacity() - filesystem.blockSize) {
+		return false;
+	}
+
+	vector<char> records(length);
+	filesystem.storage->read(base + filesystem.blockSize, &records[0], length);
+	if (checksum(&records[0], length) != sum) {
+		return false;
+	}
+
+	/* tulis setiap rekaman ke lokasi aslinya */
+	off_t end = filesystem.storage->size();
+	size_t i = 0;
+	while (i + JOURNAL_RECORD_HEADER <= length) {
+		unsigned long long position;
+		unsigned int size;
+		memcpy((char*)&position, &records[i], 8);
+		memcpy((char*)&size, &records[i + 8], 4);
+		i += JOURNAL_RECORD_HEADER;
+		if (i + size > length || (off_t)(position + size) > end) {
+			throw runtime_error("Journal POI rusak");
+		}
+		filesystem.storage->write(position, &records[i], size);
+		i += size;
+	}
+	filesystem.storage->sync();
+
+	/* transaksi sudah di lokasi asli, journal dikosongkan */
+	memcpy((char*)&sequence, header + 0x08, 8);
+	writeCommitBlock(0, 0);
+	filesystem.storage->sync();
+	replays++;
+	return true;
+}
+
+/**
+ * Menulis sebagian blok metadata data pool ke transaksi berjalan.
+ * Isi lama diambil dari volume (frame cache lama dibuang) saat blok
+ * pertama kali berubah di transaksi ini. Dipanggil dengan metaLock.
+ * @param position blok
+ * @param offset   offset dalam blok
+ * @param buffer
+ * @param size     tidak melewati batas blok
+ */
+void Journal::put(Block position, int offset, const char *buffer, int size) {
+	MutexGuard guard(lock);
+	unordered_map<Block, vector<char> >::iterator it = pending.find(position);
+	if (it == pending.end()) {
+		vector<char> &image = pending[position];
+		image.resize(filesystem.blockSize);
+		filesystem.cache.sync(position, true);
+		if (offset != 0 || size != filesystem.blockSize) {
+			filesystem.storage->read(filesystem.blockOffset(position), &image[0], filesystem.blockSize);
+		}
+		pendingSize += filesystem.blockSize + JOURNAL_RECORD_HEADER;
+		it = pending.find(position);
+	}
+	memcpy(&it->second[offset], buffer, size);
+}
+
+/**
+ * Membaca sebagian blok dari transaksi berjalan
+ * @return false jika blok tidak berubah di transaksi ini
+ */
+bool Journal::read(Block position, int offset, char *buffer, int size) {
+	if (!enabled) {
+		return false;
+	}
+	MutexGuard guard(lock);
+	unordered_map<Block, vector<char> >::iterator it = pending.find(position);
+	if (it == pending.end()) {
+		return false;
+	}
+	memcpy(buffer, &it->second[offset], size);
+	return true;
+}
+
+/**
+ * Mencatat blok yang dibebaskan. Blok baru kembali ke allocator setelah
+ * commit, agar tidak dipakai ulang sebagai isi file selama volume masih
+ * bisa kembali ke keadaan sebelum transaksi ini.
+ * @param start  blok pertama
+ * @param length jumlah blok
+ */
+void Journal::release(Block start, Block length) {
+	MutexGuard guard(lock);
+	for (Block i = 0; i < length; i++) {
+		unordered_map<Block, vector<char> >::iterator it = pending.find(start + i);
+		if (it != pending.end()) {
+			pendingSize -= filesystem.blockSize + JOURNAL_RECORD_HEADER;
+			pending.erase(it);
+		}
+	}
+	if (!freed.empty() && freed.back().start + freed.back().length == start) {
+		freed.back().length += length;
+	}
+	else {
+		Extent extent = {start, length};
+		freed.push_back(extent);
+	}
+}
+
+/**
+ * Group commit: allocation table dan header (writes) bersama blok metadata
+ * data pool ditulis ke journal dan di-fsync, lalu ke lokasi aslinya dan
+ * di-fsync lagi. Dipanggil dengan metaLock.
+ * @param writes penulisan allocation table dan header
+ */
+void Journal::commit(vector<MetadataWrite> &writes) {
+	MutexGuard guard(lock);
+	for (unordered_map<Block, vector<char> >::iterator it = pending.begin(); it != pending.end(); ++it) {
+		MetadataWrite write;
+		write.position = filesystem.blockOffset(it->first);
+		write.data.swap(it->second);
+		writes.push_back(write);
+	}
+	pending.clear();
+	pendingSize = 0;
+	if (writes.empty()) {
+		releaseFreed();
+		return;
+	}
+
+	int blockSize = filesystem.blockSize;
+	size_t length = 0;
+	for (size_t i = 0; i < writes.size(); i++) {
+		length += JOURNAL_RECORD_HEADER + writes[i].data.size();
+	}
+
+	if (length <= capacity() - blockSize) {
+		/* susun rekaman setelah blok commit, satu penulisan ke journal */
+		vector<char> buffer(blockSize + (length + blockSize - 1) / blockSize * blockSize, 0);
+		size_t i = blockSize;
+		for (size_t j = 0; j < writes.size(); j++) {
+			unsigned long long position = writes[j].position;
+			unsigned int size = writes[j].data.size();
+			memcpy(&buffer[i], (char*)&position, 8);
+			memcpy(&buffer[i + 8], (char*)&size, 4);
+			memcpy(&buffer[i + JOURNAL_RECORD_HEADER], &writes[j].data[0], size);
+			i += JOURNAL_RECORD_HEADER + size;
+		}
+
+		sequence++;
+		unsigned long long sum = checksum(&buffer[blockSize], length);
+		memcpy(&buffer[0x00], "jrnl", 4);
+		memcpy(&buffer[0x08], (char*)&sequence, 8);
+		memcpy(&buffer[0x10], (char*)&length, 8);
+		memcpy(&buffer[0x18], (char*)&sum, 8);
+		filesystem.storage->write(filesystem.blockOffset(start), &buffer[0], buffer.size());
+		filesystem.storage->sync();
+	}
+	else {
+		/* transaksi lebih besar dari journal ditulis langsung, tidak atomik */
+		overflows++;
+	}
+
+	vector<IORequest> batch;
+	for (size_t j = 0; j < writes.size(); j++) {
+		IORequest request = {writes[j].position, &writes[j].data[0], writes[j].data.size()};
+		batch.push_back(request);
+	}
+	filesystem.storage->writeBatch(batch);
+	filesystem.metadataWrites += writes.size();
+	filesystem.storage->sync();
+
+	/* tidak perlu fsync: memutar ulang transaksi ini tetap benar */
+	if (length <= capacity() - blockSize) {
+		writeCommitBlock(0, 0);
+	}
+	commits++;
+	releaseFreed();
+}
+
+/**
+ * Besar transaksi berjalan dalam byte (tanpa allocation table)
+ */
+size_t Journal::pendingBytes() {
+	MutexGuard guard(lock);
+	return pendingSize;
+}
+
+/**
+ * Besar area journal dalam byte
+ */
+size_t Journal::capacity() {
+	return (size_t)blocks * filesystem.blockSize;
+}
+
+/**
+ * Checksum FNV-1a 64 bit
+ */
+unsigned long long Journal::checksum(const char *data, size_t size) {
+	unsigned long long result = 14695981039346656037ULL;
+	for (size_t i = 0; i < size; i++) {
+		result ^= (unsigned char)data[i];
+		result *= 1099511628211ULL;
+	}
+	return result;
+}
+
+/**
+ * Menulis blok commit
+ * @param length panjang rekaman, 0 untuk journal kosong
+ * @param sum    checksum rekaman
+ */
+void Journal::writeCommitBlock(unsigned long long length, unsigned long long sum) {
+	vector<char> buffer(filesystem.blockSize, 0);
+	memcpy(&buffer[0x00], "jrnl", 4);
+	memcpy(&buffer[0x08], (char*)&sequence, 8);
+	memcpy(&buffer[0x10], (char*)&length, 8);
+	memcpy(&buffer[0x18], (char*)&sum, 8);
+	filesystem.storage->write(filesystem.blockOffset(start), &buffer[0], buffer.size());
+}
+
+/**
+ * Blok yang dibebaskan transaksi berjalan sudah kosong di allocation
+ * table yang di-commit bersama header, sehingga dihitung bebas di header
+ * @param available jumlah blok bebas, ditambah
+ * @param first     blok bebas pertama, diturunkan jika perlu
+ */
+void Journal::freedSpace(Block &available, Block &first) {
+	MutexGuard guard(lock);
+	for (size_t i = 0; i < freed.size(); i++) {
+		available += freed[i].length;
+		first = min(first, freed[i].start);
+	}
+}
+
+/**
+ * Mengembalikan blok yang dibebaskan transaksi ke allocator
+ */
+void Journal::releaseFreed() {
+	for (size_t i = 0; i < freed.size(); i++) {
+		filesystem.allocator.releaseRun(freed[i].start, freed[i].length);
+		filesystem.available += freed[i].length;
+	}
+	if (!freed.empty()) {
+		filesystem.firstEmpty = filesystem.allocator.first();
+	}
+	freed.clear();
+}
+
+///////////////////////////////////////
+// Realisasi Kelas Transaction       //
+///////////////////////////////////////
+
+/**
+ * Konstruktor, commit ditahan selama operasi berjalan
+ */
+Transaction::Transaction() {
+	filesystem.commitLock.lockShared();
+}
+
+/**
+ * Destruktor, commit jika sudah waktunya
+ */
+Transaction::~Transaction() {
+	filesystem.commitLock.unlock();
+	filesystem.endOperation();
+}
+
+///////////////////////////////////////
+// Realisasi Kelas Flusher           //
+///////////////////////////////////////
+
+/**
+ * Konstruktor, thread belum berjalan
+ */
+Flusher::Flusher() {
+	running = false;
+	stopping = false;
+}
+
+/**
+ * Menjalankan thread latar belakang, diperiksa setiap
+ * FLUSH_CHECK_INTERVAL detik
+ */
+void Flusher::start() {
+	stopping = false;
+	running = pthread_create(&thread, NULL, run, this) == 0;
+}
+
+/**
+ * Menghentikan thread, sisa perubahan ditulis oleh close
+ */
+void Flusher::stop() {
+	if (!running) {
+		return;
+	}
+	stopping = true;
+	pthread_join(thread, NULL);
+	running = false;
+}
+
+/**
+ * Isi thread latar belakang
+ */
+void *Flusher::run(void *arg) {
+	Flusher *self = (Flusher*)arg;
+	while (!self->stopping) {
+		struct timespec ts = {FLUSH_CHECK_INTERVAL, 0};
+		nanosleep(&ts, NULL);
+		if (!self->stopping) {
+			filesystem.flushExpired();
+		}
+	}
+	return NULL;
+}
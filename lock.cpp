@@ -0,0 +1,131 @@
+//////////////////////////////////
+// File lock.cpp                //
+// Lock antar thread fuse       //
+//////////////////////////////////
+
+#include "poi.hpp"
+
+/* Global filesystem */
+extern POI filesystem;
+
+////////////////////////////////
+// Realisasi Kelas Mutex      //
+////////////////////////////////
+
+/**
+ * Konstruktor
+ * @param recursive boleh dikunci ulang oleh thread yang sama
+ */
+Mutex::Mutex(bool recursive) {
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init(&attr);
+	if (recursive) {
+		pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	}
+	pthread_mutex_init(&mutex, &attr);
+	pthread_mutexattr_destroy(&attr);
+}
+
+Mutex::~Mutex() {
+	pthread_mutex_destroy(&mutex);
+}
+
+void Mutex::lock() {
+	pthread_mutex_lock(&mutex);
+}
+
+void Mutex::unlock() {
+	pthread_mutex_unlock(&mutex);
+}
+
+////////////////////////////////
+// Realisasi Kelas RWLock     //
+////////////////////////////////
+
+RWLock::RWLock() {
+	pthread_rwlock_init(&rwlock, NULL);
+}
+
+RWLock::~RWLock() {
+	pthread_rwlock_destroy(&rwlock);
+}
+
+void RWLock::lock() {
+	pthread_rwlock_wrlock(&rwlock);
+}
+
+void RWLock::lockShared() {
+	pthread_rwlock_rdlock(&rwlock);
+}
+
+void RWLock::unlock() {
+	pthread_rwlock_unlock(&rwlock);
+}
+
+////////////////////////////////
+// Realisasi Kelas LockTable  //
+////////////////////////////////
+
+/**
+ * Mengambil lock sebuah file, lock dibuat jika belum ada
+ * @param key       lokasi entry
+ * @param exclusive true untuk penulis, false untuk pembaca
+ */
+void LockTable::lock(unsigned long long key, bool exclusive) {
+	Lock *current;
+	{
+		MutexGuard guard(tableLock);
+		current = &locks[key];
+		current->refs++;
+	}
+
+	/* menunggu di luar tableLock agar file lain tidak ikut tertahan */
+	if (exclusive) {
+		current->rwlock.lock();
+	}
+	else {
+		current->rwlock.lockShared();
+	}
+}
+
+/**
+ * Melepas lock sebuah file, lock dibuang jika tidak dipakai lagi
+ * @param key lokasi entry
+ */
+void LockTable::unlock(unsigned long long key) {
+	MutexGuard guard(tableLock);
+	unordered_map<unsigned long long, Lock>::iterator it = locks.find(key);
+	it->second.rwlock.unlock();
+	if (--it->second.refs == 0) {
+		locks.erase(it);
+	}
+}
+
+/**
+ * Kunci lock dari lokasi entry (blok, offset), tetap selama
+ * namespaceLock dipegang bersama
+ */
+unsigned long long LockTable::keyOf(const Entry &entry) {
+	return ((unsigned long long)entry.position << 16) | entry.offset;
+}
+
+////////////////////////////////
+// Realisasi Kelas FileLock   //
+////////////////////////////////
+
+/**
+ * Konstruktor, mengambil lock file milik entry
+ * @param entry     entry file
+ * @param exclusive true untuk penulis
+ */
+FileLock::FileLock(const Entry &entry, bool exclusive) {
+	key = LockTable::keyOf(entry);
+	filesystem.fileLocks.lock(key, exclusive);
+}
+
+/**
+ * Destruktor, melepas lock
+ */
+FileLock::~FileLock() {
+	filesystem.fileLocks.unlock(key);
+}
@@ -3,6 +3,7 @@
 //////////////////////////
 
 #include <iostream>
+#include <vector>
 #include "mount_poi.hpp"
 #include "poi.hpp"
 
@@ -14,25 +15,170 @@ void init_fuse();
 POI filesystem;
 
 int main(int argc, char** argv){
-  if (argc < 3 || (argc > 3 && string(argv[3]) != "-new")) {
-    printf("Usage: ./poi <mount folder> <filesystem.poi> [-new]\n");
+  if (argc < 3) {
+    printf("Usage: ./poi <mount folder> <filesystem.poi> [-new] [-format=1|2] [-blocksize=<byte>] [-pointer=16|32] [-size=<n>[K|M|G|T]] [-hashdir] [-inline] [-backend=stream|mmap|uring] [-iodepth=<n>] [-dcache=<jumlah>] [-cache=<MB>] [-readahead=<KB>] [-sync=<detik>] [-durability=none|group|op] [-defrag[=<MB/s>]] [-kcache=<detik>] [-negcache=<detik>] [-mt] [opsi fuse]\n");
     return 0;
   }
 
-  // Argumen -new; buat poi baru
-  if (argc > 3 && string(argv[3]) == "-new") {
-    filesystem.create(argv[2]);
+  // Buat argumen baru untuk fuse, opsi poi tidak diteruskan
+  vector<char*> fuse_argv;
+  fuse_argv.push_back(argv[0]);
+  fuse_argv.push_back(argv[1]);
+
+  // timeout cache kernel bawaan libfuse, lebih lama dengan -kcache/-negcache
+  filesystem.kernelTimeout = KERNEL_TIMEOUT;
+  int negativeTimeout = KERNEL_NEGATIVE_TIMEOUT;
+
+  bool isNew = false;
+  bool hashdir = false;
+  bool inlineData = false;
+  bool multithread = false;
+  int version = VOLUME_VERSION_FAT;
+  int blockSize = POI_BLOCK_SIZE;
+  int pointerWidth = 0;
+  unsigned long long size = 0;
+  for (int i = 3; i < argc; i++) {
+    string arg(argv[i]);
+    if (arg == "-new") {
+      isNew = true;
+    }
+    else if (arg.compare(0, 8, "-format=") == 0) {
+      version = atoi(argv[i] + 8);
+    }
+    else if (arg.compare(0, 11, "-blocksize=") == 0) {
+      blockSize = atoi(argv[i] + 11);
+    }
+    else if (arg.compare(0, 9, "-pointer=") == 0) {
+      pointerWidth = atoi(argv[i] + 9) / 8;
+    }
+    else if (arg.compare(0, 6, "-size=") == 0) {
+      // ukuran volume dalam byte, boleh diakhiri K, M, G atau T
+      char *unit;
+      size = strtoull(argv[i] + 6, &unit, 10);
+      for (const char *units = "KMGT"; *units != 0 && *unit != 0; units++) {
+        size *= 1024;
+        if (toupper(*unit) == *units) {
+          break;
+        }
+      }
+    }
+    else if (arg == "-hashdir") {
+      hashdir = true;
+    }
+    else if (arg == "-inline") {
+      // file kecil disimpan di entry direktori, hanya format 2
+      inlineData = true;
+    }
+    else if (arg == "-backend=mmap") {
+      filesystem.backend = BACKEND_MMAP;
+    }
+    else if (arg == "-backend=uring") {
+      filesystem.backend = BACKEND_URING;
+    }
+    else if (arg.compare(0, 9, "-iodepth=") == 0) {
+      // jumlah permintaan io_uring yang berjalan bersamaan
+      filesystem.ioDepth = atoi(argv[i] + 9);
+    }
+    else if (arg == "-backend=stream") {
+      filesystem.backend = BACKEND_STREAM;
+    }
+    else if (arg.compare(0, 8, "-dcache=") == 0) {
+      filesystem.dentry.setCapacity(atoi(argv[i] + 8));
+    }
+    else if (arg.compare(0, 7, "-cache=") == 0) {
+      filesystem.cache.setBudget((size_t)atoi(argv[i] + 7) * 1024 * 1024);
+    }
+    else if (arg.compare(0, 11, "-readahead=") == 0) {
+      // jendela readahead maksimum, 0 = tanpa readahead
+      filesystem.readaheadMax = atoi(argv[i] + 11) * 1024;
+    }
+    else if (arg.compare(0, 6, "-sync=") == 0) {
+      // interval penulisan metadata, 0 = setiap perubahan langsung ditulis
+      filesystem.syncInterval = atoi(argv[i] + 6);
+    }
+    else if (arg == "-durability=op") {
+      // commit journal dan fsync di akhir setiap operasi
+      filesystem.durability = DURABILITY_OP;
+    }
+    else if (arg == "-durability=group") {
+      // group commit setiap -sync detik; area journal dibuat di blok
+      // bebas volume saat mount pertama dengan opsi ini
+      filesystem.durability = DURABILITY_GROUP;
+    }
+    else if (arg == "-durability=none") {
+      // bawaan; tanpa journal, metadata ditulis langsung seperti volume lama
+      filesystem.durability = DURABILITY_NONE;
+    }
+    else if (arg == "-defrag") {
+      // defragmentasi latar belakang tanpa batas kecepatan
+      filesystem.defrag.enabled = true;
+    }
+    else if (arg.compare(0, 8, "-defrag=") == 0) {
+      filesystem.defrag.enabled = true;
+      filesystem.defrag.rate = atoi(argv[i] + 8);
+    }
+    else if (arg.compare(0, 8, "-kcache=") == 0) {
+      // timeout entry dan atribut kernel, 0 = setiap syscall memanggil getattr;
+      // ukuran file setelah ioctl clone baru terlihat setelah timeout ini
+      filesystem.kernelTimeout = atoi(argv[i] + 8);
+    }
+    else if (arg.compare(0, 10, "-negcache=") == 0) {
+      negativeTimeout = atoi(argv[i] + 10);
+    }
+    else if (arg == "-mt") {
+      multithread = true;
+    }
+    else {
+      fuse_argv.push_back(argv[i]);
+    }
+  }
+
+  // tanpa -mt fuse berjalan dengan satu thread
+  char single[] = "-s";
+  if (!multithread) {
+    fuse_argv.push_back(single);
+  }
+
+  // cache kernel; isi file disimpan lewat keep_cache di poi_open (bukan
+  // kernel_cache) agar file yang diubah di luar kernel bisa diinvalidasi
+  char kernelOptions[256];
+  snprintf(kernelOptions, sizeof(kernelOptions),
+    "-oentry_timeout=%d,attr_timeout=%d,negative_timeout=%d,max_read=%d,max_write=%d,big_writes",
+    filesystem.kernelTimeout, filesystem.kernelTimeout,
+    filesystem.kernelTimeout > 0 ? negativeTimeout : 0, KERNEL_IO_MAX, KERNEL_IO_MAX);
+  fuse_argv.push_back(kernelOptions);
+
+  // Argumen -new; buat poi baru, -format memilih versi format volume,
+  // volume lebih dari N_BLOCK blok otomatis memakai pointer 32 bit
+  if (isNew) {
+    unsigned long long blocks = size / blockSize;
+    if (pointerWidth == 0) {
+      pointerWidth = blocks > N_BLOCK ? 4 : POINTER_WIDTH;
+    }
+    if (blocks >= END_BLOCK) {
+      printf("Ukuran volume terlalu besar\n");
+      return 1;
+    }
+    int flags = (hashdir ? VOLUME_HASHED_DIRS : 0) | (inlineData ? VOLUME_INLINE_DATA : 0);
+    filesystem.create(argv[2], flags, version, blockSize, pointerWidth, (Block)blocks);
   }
 
   filesystem.load(argv[2]);
 
-  // Buat argumen baru untuk fuse
-  int fuse_argc = 2;
-  char* fuse_argv[2] = {argv[0], argv[1]};
+  // io_uring bisa ditolak kernel/sandbox, backend tetap jalan dengan pread/pwrite
+  if (filesystem.backend == BACKEND_URING && !((UringStorage*)filesystem.storage)->available()) {
+    printf("io_uring tidak tersedia, memakai pread/pwrite\n");
+  }
+
+  // Argumen -hashdir pada volume lama; direktori besar di-upgrade saat bertambah
+  if (hashdir && !(filesystem.flags & VOLUME_HASHED_DIRS)) {
+    filesystem.flags |= VOLUME_HASHED_DIRS;
+    filesystem.writeVolumeInformation();
+  }
 
   // Jalankan fuse
   init_fuse();
-  return fuse_main(fuse_argc, fuse_argv, &poi_oper, NULL);
+  return fuse_main((int)fuse_argv.size(), fuse_argv.data(), &poi_oper, NULL);
 }
 
 void init_fuse() {
@@ -41,13 +187,21 @@ void init_fuse() {
   poi_oper.mkdir = poi_mkdir;
   poi_oper.mknod = poi_mknod;
   poi_oper.read = poi_read;
+  poi_oper.read_buf = poi_read_buf;
   poi_oper.rmdir = poi_rmdir;
   poi_oper.unlink = poi_unlink;
   poi_oper.rename = poi_rename;
   poi_oper.write = poi_write;
+  poi_oper.write_buf = poi_write_buf;
   poi_oper.utimens = poi_utimens;
   poi_oper.truncate = poi_truncate;
   poi_oper.chmod = poi_chmod;
   poi_oper.link = poi_link;
   poi_oper.open = poi_open;
+  poi_oper.release = poi_release;
+  poi_oper.fsync = poi_fsync;
+  poi_oper.ioctl = poi_ioctl;
+  poi_oper.fallocate = poi_fallocate;
+  poi_oper.init = poi_init;
+  poi_oper.destroy = poi_destroy;
 };
@@ -8,6 +8,176 @@ using namespace std;
 
 extern POI filesystem; // akan dideklarasi di main program
 
+/* File yang isinya diubah tanpa melalui kernel (ioctl clone), beserta
+   waktu atribut lamanya di cache kernel kedaluwarsa. Sampai saat itu
+   file dibuka dengan direct_io, page cache dibuang sekali lagi sesudahnya */
+static unordered_map<string, time_t> kernelStale;
+static Mutex kernelLock;
+
+/**
+ * Mendapatkan isi direktori dari path
+ * @param  path      path direktori, "" atau "/" untuk root
+ * @param  directory hasil
+ * @return           0 jika direktori ditemukan
+ */
+static int getDirectory(const char *path, Directory &directory) {
+	if (string(path) == "" || string(path) == "/") {
+		directory = Directory::root();
+		return 0;
+	}
+
+	Entry entry = filesystem.lookup(path);
+	if (entry.isEmpty() || !(entry.getAttr() & 0x8)) {
+		return -ENOENT;
+	}
+	directory = Directory(entry);
+	return 0;
+}
+
+/**
+ * Mendapatkan handle file dari file info; jika file tidak dibuka
+ * melalui poi_open, handle sementara dibuat dari path
+ * @param  path [description]
+ * @param  fi   [description]
+ * @param  temp handle sementara
+ * @return      [description]
+ */
+static FileHandle *getHandle(const char *path, struct fuse_file_info *fi, FileHandle &temp) {
+	if (fi != NULL && fi->fh != 0) {
+		return (FileHandle*)(uintptr_t)fi->fh;
+	}
+	temp.entry = filesystem.lookup(path);
+	return &temp;
+}
+
+/**
+ * Membaca ulang entry handle sementara setelah lock file didapat,
+ * salinan dari lookup bisa mendahului penulisan thread lain.
+ * Handle dari poi_open selalu diperbarui oleh HandleTable.
+ * @param handle handle yang dipakai
+ * @param temp   handle sementara
+ */
+static void refreshHandle(FileHandle *handle, FileHandle &temp) {
+	if (handle == &temp) {
+		temp.entry = Entry(temp.entry.position, temp.entry.offset);
+	}
+}
+
+/**
+ * Apakah path menunjuk file statistik virtual
+ * @param  path [description]
+ * @return      [description]
+ */
+static bool isStats(const char *path) {
+	return strcmp(path, STATS_PATH) == 0;
+}
+
+/**
+ * Isi file statistik: salinan yang dibuat saat poi_open, atau dibuat
+ * ulang jika file dibaca tanpa dibuka
+ * @param  fi [description]
+ * @return    [description]
+ */
+static string statsContent(struct fuse_file_info *fi) {
+	if (fi != NULL && fi->fh != 0) {
+		return *(string*)(uintptr_t)fi->fh;
+	}
+	return filesystem.stats.report();
+}
+
+/**
+ * Mengisi atribut stat dari sebuah entry
+ * @param entry [description]
+ * @param stbuf [description]
+ */
+static void fillStat(Entry &entry, struct stat *stbuf) {
+	stbuf->st_nlink = 1;
+
+	// cek direktori atau bukan
+	if (entry.getAttr() & 0x8) {
+		stbuf->st_mode = S_IFDIR | (0770 + (entry.getAttr() & 0x7));
+	}	else {
+		stbuf->st_mode = S_IFREG | (0660 + (entry.getAttr() & 0x7));
+	}
+
+	// ukuran file
+	stbuf->st_size = entry.getSize();
+
+	// waktu pembuatan file
+	stbuf->st_mtime = entry.getDateTime();
+
+	// waktu akses file
+	stbuf->st_atime = entry.getDateTime();
+}
+
+/**
+ * Menandai isi dan atribut file di cache kernel tidak berlaku lagi
+ * @param path [description]
+ */
+static void invalidateKernel(const string &path) {
+	if (filesystem.kernelTimeout > 0) {
+		MutexGuard guard(kernelLock);
+		kernelStale[path] = time(NULL) + filesystem.kernelTimeout + 1;
+	}
+}
+
+/**
+ * Memindahkan tanda invalidasi saat path (atau isi direktori path)
+ * berganti nama; newpath kosong berarti path dihapus
+ * @param path    [description]
+ * @param newpath [description]
+ */
+static void renameKernel(const string &path, const string &newpath) {
+	MutexGuard guard(kernelLock);
+	if (kernelStale.empty()) {
+		return;
+	}
+	if (!newpath.empty()) {
+		kernelStale.erase(newpath);
+	}
+	vector<pair<string, time_t> > moved;
+	for (unordered_map<string, time_t>::iterator it = kernelStale.begin(); it != kernelStale.end(); ) {
+		if (it->first == path || it->first.compare(0, path.length() + 1, path + "/") == 0) {
+			moved.push_back(make_pair(it->first.substr(path.length()), it->second));
+			it = kernelStale.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+	for (unsigned int i = 0; i < moved.size() && !newpath.empty(); i++) {
+		kernelStale[newpath + moved[i].first] = moved[i].second;
+	}
+}
+
+/**
+ * Apakah page cache kernel untuk file boleh dipakai ulang saat dibuka.
+ * Tanda invalidasi dibuang setelah atribut lama kedaluwarsa; pembukaan
+ * itu masih membuang page cache agar isi dan ukuran baru dibaca ulang.
+ * @param  path   [description]
+ * @param  direct hasil, file dibaca tanpa page cache karena ukuran
+ *                di cache atribut kernel mungkin masih ukuran lama
+ * @return        [description]
+ */
+static bool keepKernelCache(const char *path, bool &direct) {
+	direct = false;
+	if (filesystem.kernelTimeout == 0) {
+		return false;
+	}
+	MutexGuard guard(kernelLock);
+	unordered_map<string, time_t>::iterator it = kernelStale.find(path);
+	if (it == kernelStale.end()) {
+		return true;
+	}
+	if (time(NULL) < it->second) {
+		direct = true;
+	}
+	else {
+		kernelStale.erase(it);
+	}
+	return false;
+}
+
 /* Spesifikasi wajib */
 
 /**
@@ -17,6 +187,16 @@ extern POI filesystem; // akan dideklarasi di main program
  * @return       [description]
  */
 int poi_getattr(const char* path, struct stat* stbuf) {
+	StatTimer timer(filesystem.stats.ops[OP_GETATTR]);
+	/* file statistik hanya bisa dibaca, ukuran sesuai isi saat ini */
+	if (isStats(path)) {
+		stbuf->st_nlink = 1;
+		stbuf->st_mode = S_IFREG | 0444;
+		stbuf->st_size = filesystem.stats.report().size();
+		stbuf->st_mtime = time(NULL);
+		return 0;
+	}
+
 	/* jika root path */
 	if (string(path) == "/"){
 		stbuf->st_nlink = 1;
@@ -25,7 +205,8 @@ int poi_getattr(const char* path, struct stat* stbuf) {
 		return 0;
 	}
 	else {
-		Entry entry = Entry(0, 0).getEntry(path);
+		RWGuard guard(filesystem.namespaceLock, false);
+		Entry entry = filesystem.lookup(path);
 
 		//Kalau path tidak ditemukan
 		if (entry.isEmpty()) {
@@ -33,30 +214,17 @@ int poi_getattr(const char* path, struct stat* stbuf) {
 		}
 
 		// tulis stbuf, tempat memasukkan atribut file
-		stbuf->st_nlink = 1;
-
-		// cek direktori atau bukan
-		if (entry.getAttr() & 0x8) {
-			stbuf->st_mode = S_IFDIR | (0770 + (entry.getAttr() & 0x7));
-		}	else {
-			stbuf->st_mode = S_IFREG | (0660 + (entry.getAttr() & 0x7));
-		}
-
-		// ukuran file
-		stbuf->st_size = entry.getSize();
-
-		// waktu pembuatan file
-		stbuf->st_mtime = entry.getDateTime();
-
-		// waktu akses file
-		stbuf->st_atime = entry.getDateTime();
-
+		fillStat(entry, stbuf);
 		return 0;
 	}
 }
 
 /**
- * Membaca directory
+ * Membaca directory. Offset yang diberikan ke filler adalah posisi slot
+ * sesudah entry, sehingga direktori besar dibaca per halaman buffer fuse
+ * dan pemanggilan berikutnya melanjutkan dari posisi itu. Atribut setiap
+ * entry diisi langsung dan entry dimasukkan ke dentry cache, agar getattr
+ * sesudahnya (ls -l) tidak menelusuri path dari root.
  * @param  path   [description]
  * @param  buf    [description]
  * @param  filler [description]
@@ -65,21 +233,51 @@ int poi_getattr(const char* path, struct stat* stbuf) {
  * @return        [description]
  */
 int poi_readdir(const char *path, void *buf, fuse_fill_dir_t filler, off_t offset, struct fuse_file_info *fi){
-	// current & parent directory
-	filler(buf, ".", NULL, 0);
-	filler(buf, "..", NULL, 0);
-
-	Entry entry = Entry(0, 0).getEntry(path);
-	Block index = entry.getIndex();
-	entry = Entry(index, 0);
-
-	// Menuliskan setiap entry ke buffer "buf"
-	while (entry.position != END_BLOCK) {
-		if (!entry.isEmpty()) {
-			filler(buf, entry.getName().c_str(), NULL, 0);
-		}
+	StatTimer timer(filesystem.stats.ops[OP_READDIR]);
+	/* operasi ini tidak mengubah isi direktori */
+	RWGuard guard(filesystem.namespaceLock, false);
+
+	Directory directory;
+	if (getDirectory(path, directory) != 0) {
+		return -ENOENT;
+	}
+
+	// current & parent directory; filler mengembalikan 1 jika buffer penuh
+	bool root = string(path) == "" || string(path) == "/";
+	if (offset < 1 && filler(buf, ".", NULL, 1)) {
+		return 0;
+	}
+	if (offset < 2 && filler(buf, "..", NULL, 2)) {
+		return 0;
+	}
+	if (root && offset < 3 && filler(buf, STATS_PATH + 1, NULL, 3)) {
+		return 0;
+	}
 
-		entry = entry.nextEntry();
+	// Menuliskan setiap entry ke buffer "buf", mulai dari posisi offset
+	string prefix = root ? "" : string(path);
+	off_t cursor = max(offset, (off_t)READDIR_OFFSET) - READDIR_OFFSET;
+	bool more = true;
+	while (more) {
+		vector<Entry> entries;
+		vector<off_t> next;
+		more = directory.list(cursor, READDIR_PAGE, entries, next);
+		for (unsigned int i = 0; i < entries.size(); i++) {
+			string name = entries[i].getName();
+			if (root && name == STATS_PATH + 1) {
+				continue;
+			}
+			struct stat stbuf;
+			memset(&stbuf, 0, sizeof(stbuf));
+			fillStat(entries[i], &stbuf);
+			if (filler(buf, name.c_str(), &stbuf, READDIR_OFFSET + next[i])) {
+				return 0;
+			}
+			filesystem.dentry.put(prefix + "/" + name, directory.index, entries[i]);
+		}
+		if (!next.empty()) {
+			cursor = next.back();
+		}
 	}
 
 	return 0;
@@ -92,8 +290,16 @@ int poi_readdir(const char *path, void *buf, fuse_fill_dir_t filler, off_t offse
  * @return      [description]
  */
 int poi_mkdir(const char *path, mode_t mode){
+	StatTimer timer(filesystem.stats.ops[OP_MKDIR]);
+	if (isStats(path)) {
+		return -EEXIST;
+	}
+	/* operasi ini mengubah isi direktori */
+	RWGuard guard(filesystem.namespaceLock, true);
+	Transaction transaction;
 	int i;
 	string parentPath;
+	Directory parent;
 	Entry entry;
 
 	// Mencari parent directory
@@ -101,26 +307,23 @@ int poi_mkdir(const char *path, mode_t mode){
 
 	parentPath = string(path, i);
 
-	if (parentPath == "") {
-		entry = Entry(0, 0);
-	}
-	else {
-		entry = Entry(0, 0).getEntry(parentPath.c_str());
-		Block idx = entry.getIndex();
-		entry = Entry(idx, 0);
+	if (getDirectory(parentPath.c_str(), parent) != 0) {
+		return -ENOENT;
 	}
 
 	// mencari entry kosong di parent
-	entry = entry.getNextEmptyEntry();
+	entry = parent.emptySlot(path + i + 1);
 
 	// menulis data entry
 	entry.setName(path + i + 1);
-	entry.setAttr(0x0F);
+	bool hashed = (filesystem.flags & VOLUME_HASHED_DIRS) != 0;
+	entry.setAttr(0x0F | (hashed ? ATTR_HASHED : 0));
 	entry.setCurrentDateTime();
-	entry.setIndex(filesystem.allocateBlock());
+	entry.setIndex(Directory::create(hashed));
 	entry.setSize(0);
 
 	entry.write();
+	filesystem.dentry.invalidate(path);
 
 	return 0;
 }
@@ -133,8 +336,16 @@ int poi_mkdir(const char *path, mode_t mode){
  * @return      [description]
  */
 int poi_mknod(const char *path, mode_t mode, dev_t dev){
+	StatTimer timer(filesystem.stats.ops[OP_MKNOD]);
+	if (isStats(path)) {
+		return -EEXIST;
+	}
+	/* operasi ini mengubah isi direktori */
+	RWGuard guard(filesystem.namespaceLock, true);
+	Transaction transaction;
 	int i;
 	string parentPath;
+	Directory parent;
 	Entry entry;
 
 	// Mencari parent directory
@@ -142,27 +353,23 @@ int poi_mknod(const char *path, mode_t mode, dev_t dev){
 
 	parentPath = string(path, i);
 
-	if (parentPath == "") {
-		entry = Entry(0, 0);
-	}
-	else {
-		entry = Entry(0, 0).getEntry(parentPath.c_str());
-		Block idx = entry.getIndex();
-		entry = Entry(idx, 0);
+	if (getDirectory(parentPath.c_str(), parent) != 0) {
+		return -ENOENT;
 	}
 
 	// mencari entry kosong di parent
-	entry = entry.getNextEmptyEntry();
+	entry = parent.emptySlot(path + i + 1);
 
 	// menulis data entry
 	entry.setName(path + i + 1);
 	entry.setAttr(0x06);
 	entry.setTime(0x00);
 	entry.setCurrentDateTime();
-	entry.setIndex(filesystem.allocateBlock());
 	entry.setSize(0x00);
+	filesystem.initFile(entry);
 
 	entry.write();
+	filesystem.dentry.invalidate(path);
 
 	return 0;
 }
@@ -177,14 +384,143 @@ int poi_mknod(const char *path, mode_t mode, dev_t dev){
  * @return        [description]
  */
 int poi_read(const char *path,char *buf,size_t size,off_t offset,struct fuse_file_info *fi){
-	Entry entry = Entry(0, 0).getEntry(path);
-	Block index = entry.getIndex();
+	StatTimer timer(filesystem.stats.ops[OP_READ]);
+	if (isStats(path)) {
+		string content = statsContent(fi);
+		if (offset >= (off_t)content.size()) {
+			return 0;
+		}
+		size = min(size, content.size() - offset);
+		memcpy(buf, content.data() + offset, size);
+		timer.bytes = size;
+		return size;
+	}
+	/* operasi ini tidak mengubah isi direktori */
+	RWGuard guard(filesystem.namespaceLock, false);
+	FileHandle temp;
+	FileHandle *handle = getHandle(path, fi, temp);
 
-	if (entry.isEmpty()){
+	if (handle->entry.isEmpty()){
 		return -ENOENT;
 	}
+	FileLock lock(handle->entry, false);
+	refreshHandle(handle, temp);
 
-	return filesystem.readBlock(index, buf, size, offset);
+	// tidak membaca melewati ukuran file
+	off_t fileSize = handle->entry.getSize();
+	if (offset >= fileSize) {
+		return 0;
+	}
+	if (offset + (off_t)size > fileSize) {
+		size = fileSize - offset;
+	}
+
+	int result = filesystem.readFile(*handle, buf, size, offset);
+	timer.bytes = result;
+	return result;
+}
+
+/**
+ * Membaca file tanpa menyalin isi: setiap potongan berurutan dikembalikan
+ * sebagai descriptor file .poi dan offset, fuse menyalin (atau splice)
+ * langsung dari volume. Bagian file tanpa blok dikembalikan sebagai nol.
+ * Penyalinan terjadi setelah lock dilepas, dengan -mt truncate yang
+ * bersamaan bisa membuat pembaca melihat isi lama blok yang dibebaskan.
+ * @param  path   [description]
+ * @param  bufp   diisi bufvec yang dibebaskan oleh fuse
+ * @param  size   [description]
+ * @param  offset [description]
+ * @param  fi     [description]
+ * @return        [description]
+ */
+int poi_read_buf(const char *path, struct fuse_bufvec **bufp, size_t size, off_t offset, struct fuse_file_info *fi) {
+	StatTimer timer(filesystem.stats.ops[OP_READ_BUF]);
+	if (isStats(path)) {
+		string content = statsContent(fi);
+		size = offset >= (off_t)content.size() ? 0 : min(size, content.size() - offset);
+		struct fuse_bufvec *bufv = (struct fuse_bufvec*)malloc(sizeof(struct fuse_bufvec));
+		if (bufv == NULL) {
+			return -ENOMEM;
+		}
+		*bufv = FUSE_BUFVEC_INIT(size);
+		bufv->buf[0].mem = malloc(max(size, (size_t)1));
+		if (bufv->buf[0].mem == NULL) {
+			free(bufv);
+			return -ENOMEM;
+		}
+		memcpy(bufv->buf[0].mem, content.data() + offset, size);
+		timer.bytes = size;
+		*bufp = bufv;
+		return 0;
+	}
+	/* operasi ini tidak mengubah isi direktori */
+	RWGuard guard(filesystem.namespaceLock, false);
+	FileHandle temp;
+	FileHandle *handle = getHandle(path, fi, temp);
+
+	if (handle->entry.isEmpty()){
+		return -ENOENT;
+	}
+	FileLock lock(handle->entry, false);
+	refreshHandle(handle, temp);
+
+	// tidak membaca melewati ukuran file
+	off_t fileSize = handle->entry.getSize();
+	if (offset >= fileSize) {
+		size = 0;
+	}
+	else if (offset + (off_t)size > fileSize) {
+		size = fileSize - offset;
+	}
+
+	/* isi inline tidak ada di data pool, dikembalikan dari memori */
+	if (filesystem.isInline(handle->entry)) {
+		struct fuse_bufvec *bufv = (struct fuse_bufvec*)malloc(sizeof(struct fuse_bufvec));
+		if (bufv == NULL) {
+			return -ENOMEM;
+		}
+		*bufv = FUSE_BUFVEC_INIT(size);
+		bufv->buf[0].mem = malloc(max(size, (size_t)1));
+		if (bufv->buf[0].mem == NULL) {
+			free(bufv);
+			return -ENOMEM;
+		}
+		filesystem.readFile(*handle, (char*)bufv->buf[0].mem, size, offset);
+		timer.bytes = size;
+		*bufp = bufv;
+		return 0;
+	}
+
+	vector<Segment> segments;
+	filesystem.mapFile(*handle, size, offset, false, segments);
+
+	/* bufvec dengan satu fuse_buf per potongan */
+	size_t count = max((size_t)1, segments.size());
+	struct fuse_bufvec *bufv = (struct fuse_bufvec*)malloc(sizeof(struct fuse_bufvec) + (count - 1) * sizeof(struct fuse_buf));
+	if (bufv == NULL) {
+		return -ENOMEM;
+	}
+	*bufv = FUSE_BUFVEC_INIT(0);
+	bufv->count = count;
+	for (size_t i = 0; i < segments.size(); i++) {
+		struct fuse_buf &buf = bufv->buf[i];
+		buf.size = segments[i].size;
+		if (segments[i].position == -1) {
+			buf.flags = (enum fuse_buf_flags)0;
+			buf.mem = calloc(1, buf.size);
+			buf.fd = -1;
+			buf.pos = 0;
+		}
+		else {
+			buf.flags = (enum fuse_buf_flags)(FUSE_BUF_IS_FD | FUSE_BUF_FD_SEEK);
+			buf.mem = NULL;
+			buf.fd = filesystem.storage->descriptor();
+			buf.pos = segments[i].position;
+		}
+	}
+	timer.bytes = size;
+	*bufp = bufv;
+	return 0;
 }
 
 /**
@@ -193,15 +529,33 @@ int poi_read(const char *path,char *buf,size_t size,off_t offset,struct fuse_fil
  * @return      [description]
  */
 int poi_rmdir(const char *path){
-	Entry entry = Entry(0, 0).getEntry(path);
+	StatTimer timer(filesystem.stats.ops[OP_RMDIR]);
+	if (isStats(path)) {
+		return -ENOTDIR;
+	}
+	/* operasi ini mengubah isi direktori */
+	RWGuard guard(filesystem.namespaceLock, true);
+	Transaction transaction;
+	Entry entry = filesystem.lookup(path);
 	if (entry.isEmpty()) {
 		return -ENOENT;
 	}
 
+	// direktori harus kosong agar isinya tidak bocor
+	Directory directory(entry);
+	if (!directory.list().empty()) {
+		return -ENOTEMPTY;
+	}
+
 	// menghapus dari allocation table
-	filesystem.freeBlock(entry.getIndex());
+	directory.release();
 	entry.makeEmpty();
 
+	// buang isi direktori dari dentry cache
+	filesystem.dentry.invalidate(path);
+	filesystem.dentry.invalidateTree(path);
+	filesystem.dentry.invalidateDirectory(entry.getIndex());
+
 	return 0;
 }
 
@@ -211,13 +565,22 @@ int poi_rmdir(const char *path){
  * @return      [description]
  */
 int poi_unlink(const char *path){
-	Entry entry = Entry(0, 0).getEntry(path);
-	if (entry.getAttr() & 0x8) {
+	StatTimer timer(filesystem.stats.ops[OP_UNLINK]);
+	if (isStats(path)) {
+		return -EACCES;
+	}
+	/* operasi ini mengubah isi direktori */
+	RWGuard guard(filesystem.namespaceLock, true);
+	Transaction transaction;
+	Entry entry = filesystem.lookup(path);
+	if (entry.isEmpty() || (entry.getAttr() & 0x8)) {
 		return -ENOENT;
 	}
 	else {
-		filesystem.freeBlock(entry.getIndex());
+		filesystem.releaseFile(entry);
 		entry.makeEmpty();
+		filesystem.dentry.invalidate(path);
+		renameKernel(path, "");
 	}
 
 	return 0;
@@ -230,22 +593,71 @@ int poi_unlink(const char *path){
  * @return         [description]
  */
 int poi_rename(const char* path, const char* newpath){
-	Entry entrySrc = Entry(0, 0).getEntry(path);
-	Entry entryDest = Entry(0, 0).getNewEntry(newpath);
-
-	if (!entrySrc.isEmpty()) {
-		entryDest.setAttr(entrySrc.getAttr());
-		entryDest.setIndex(entrySrc.getIndex());
-		entryDest.setSize(entrySrc.getSize());
-		entryDest.setTime(entrySrc.getTime());
-		entryDest.setDate(entrySrc.getDate());
-		entryDest.write();
-
-		entrySrc.makeEmpty();
+	StatTimer timer(filesystem.stats.ops[OP_RENAME]);
+	if (isStats(path) || isStats(newpath)) {
+		return -EACCES;
+	}
+	/* operasi ini mengubah isi direktori */
+	RWGuard guard(filesystem.namespaceLock, true);
+	Transaction transaction;
+	int i;
+	string parentPath;
+	Directory parent;
+
+	Entry entrySrc = filesystem.lookup(path);
+	if (entrySrc.isEmpty()) {
+		return -ENOENT;
+	}
+	if (string(path) == string(newpath)) {
 		return 0;
-	}	else {
+	}
+
+	// Mencari parent directory tujuan
+	for (i = strlen(newpath) - 1; newpath[i] != '/'; i--);
+
+	parentPath = string(newpath, i);
+
+	if (getDirectory(parentPath.c_str(), parent) != 0) {
 		return -ENOENT;
 	}
+
+	// tujuan yang sudah ada ditimpa, isinya dibebaskan
+	Entry entryDest = parent.find(newpath + i + 1);
+	if (!entryDest.isEmpty()) {
+		if (entryDest.getAttr() & 0x8) {
+			Directory directory(entryDest);
+			if (!directory.list().empty()) {
+				return -ENOTEMPTY;
+			}
+			directory.release();
+		}
+		else {
+			filesystem.releaseFile(entryDest);
+		}
+	}
+	else {
+		entryDest = parent.emptySlot(newpath + i + 1);
+
+		// direktori parent bisa tersusun ulang, baca ulang sumber
+		entrySrc = filesystem.lookup(path);
+	}
+
+	// handle file yang terbuka ikut pindah ke slot baru
+	vector<FileHandle*> detached = filesystem.handles.detach(entrySrc);
+
+	memcpy(entryDest.data, entrySrc.data, ENTRY_MAX_SIZE);
+	entryDest.setName(newpath + i + 1);
+	entryDest.write();
+
+	entrySrc.makeEmpty();
+	filesystem.handles.attach(detached, entryDest);
+
+	filesystem.dentry.invalidate(path);
+	filesystem.dentry.invalidateTree(path);
+	filesystem.dentry.invalidate(newpath);
+	filesystem.dentry.invalidateTree(newpath);
+	renameKernel(path, newpath);
+	return 0;
 }
 
 /**
@@ -258,19 +670,104 @@ int poi_rename(const char* path, const char* newpath){
  * @return        [description]
  */
 int poi_write(const char *path, const char *buf, size_t size, off_t offset,struct fuse_file_info *fi){
-	Entry entry = Entry(0, 0).getEntry(path);
-	Block index = entry.getIndex();
+	StatTimer timer(filesystem.stats.ops[OP_WRITE]);
+	if (isStats(path)) {
+		return -EACCES;
+	}
+	/* operasi ini tidak mengubah isi direktori */
+	RWGuard guard(filesystem.namespaceLock, false);
+	Transaction transaction;
+	FileHandle temp;
+	FileHandle *handle = getHandle(path, fi, temp);
 
 	// kasus entry kosong
-	if (entry.isEmpty()) {
+	if (handle->entry.isEmpty()) {
 		return -ENOENT;
 	}
+	if (offset + (off_t)size > filesystem.maxFileSize()) {
+		return -EFBIG;
+	}
+	FileLock lock(handle->entry, true);
+	refreshHandle(handle, temp);
 
-	entry.setSize(offset + size);
-	entry.write();
+	int result = filesystem.writeFile(*handle, buf, size, offset);
+	timer.bytes = result;
+	return result;
+}
 
-	int res = filesystem.writeBlock(index, buf, size, offset);
-	return res;
+/**
+ * Menulis file tanpa menyalin isi: blok dialokasikan lalu fuse menyalin
+ * (atau splice) data langsung ke potongan berurutan di file .poi
+ * @param  path   [description]
+ * @param  buf    data dari kernel
+ * @param  offset [description]
+ * @param  fi     [description]
+ * @return        jumlah byte yang tertulis
+ */
+int poi_write_buf(const char *path, struct fuse_bufvec *buf, off_t offset, struct fuse_file_info *fi) {
+	StatTimer timer(filesystem.stats.ops[OP_WRITE_BUF]);
+	if (isStats(path)) {
+		return -EACCES;
+	}
+	/* operasi ini tidak mengubah isi direktori */
+	RWGuard guard(filesystem.namespaceLock, false);
+	Transaction transaction;
+	FileHandle temp;
+	FileHandle *handle = getHandle(path, fi, temp);
+
+	// kasus entry kosong
+	if (handle->entry.isEmpty()) {
+		return -ENOENT;
+	}
+	size_t size = fuse_buf_size(buf);
+	if (offset + (off_t)size > filesystem.maxFileSize()) {
+		return -EFBIG;
+	}
+	FileLock lock(handle->entry, true);
+	refreshHandle(handle, temp);
+
+	/* penulisan yang masih muat inline disalin ke entry */
+	if (filesystem.isInline(handle->entry) && offset + (off_t)size <= filesystem.inlineCapacity) {
+		char data[ENTRY_MAX_SIZE];
+		struct fuse_bufvec dst = FUSE_BUFVEC_INIT(size);
+		dst.buf[0].mem = data;
+		ssize_t res = fuse_buf_copy(&dst, buf, (enum fuse_buf_copy_flags)0);
+		if (res <= 0) {
+			return res;
+		}
+		int done = filesystem.writeFile(*handle, data, res, offset);
+		timer.bytes = done;
+		return done;
+	}
+
+	vector<Segment> segments;
+	filesystem.mapFile(*handle, size, offset, true, segments);
+
+	/* salin potongan demi potongan dari buffer kernel ke volume */
+	ssize_t done = 0;
+	for (size_t i = 0; i < segments.size(); i++) {
+		struct fuse_bufvec dst = FUSE_BUFVEC_INIT(segments[i].size);
+		dst.buf[0].flags = (enum fuse_buf_flags)(FUSE_BUF_IS_FD | FUSE_BUF_FD_SEEK);
+		dst.buf[0].fd = filesystem.storage->descriptor();
+		dst.buf[0].pos = segments[i].position;
+
+		ssize_t res = fuse_buf_copy(&dst, buf, (enum fuse_buf_copy_flags)0);
+		if (res < 0) {
+			if (done == 0) {
+				return res;
+			}
+			break;
+		}
+		done += res;
+		if ((size_t)res < segments[i].size) {
+			break;
+		}
+	}
+
+	MutexGuard handleGuard(handle->lock);
+	filesystem.finishWrite(handle->entry, offset + done, false);
+	timer.bytes = done;
+	return done;
 }
 
 /**
@@ -280,28 +777,26 @@ int poi_write(const char *path, const char *buf, size_t size, off_t offset,struc
  * @return         [description]
  */
 int poi_truncate(const char *path, off_t newSize){
-	Entry entry = Entry(0, 0).getEntry(path);
-
-	// set size
-	entry.setSize(newSize);
-	entry.write();
-
-	// menangani allocation table
-	Block position = entry.getIndex();
-	while (newSize > 0) {
-		newSize -= BLOCK_SIZE;
-		if (newSize > 0) {
-			// kasus butuh alokasi baru
-			if (filesystem.nextBlock[position] == END_BLOCK)
-				filesystem.setNextBlock(position, filesystem.allocateBlock());
-
-			position = filesystem.nextBlock[position];
-		}
+	StatTimer timer(filesystem.stats.ops[OP_TRUNCATE]);
+	if (isStats(path)) {
+		return -EACCES;
 	}
+	/* operasi ini tidak mengubah isi direktori */
+	RWGuard guard(filesystem.namespaceLock, false);
+	Transaction transaction;
+	FileHandle temp;
+	temp.entry = filesystem.lookup(path);
 
-	filesystem.freeBlock(filesystem.nextBlock[position]);
-	filesystem.setNextBlock(position, END_BLOCK);
+	if (temp.entry.isEmpty()) {
+		return -ENOENT;
+	}
+	if (newSize > filesystem.maxFileSize()) {
+		return -EFBIG;
+	}
+	FileLock lock(temp.entry, true);
+	refreshHandle(&temp, temp);
 
+	filesystem.truncateFile(temp, newSize);
 	return 0;
 }
 
@@ -314,14 +809,23 @@ int poi_truncate(const char *path, off_t newSize){
  * @return      [description]
  */
 int poi_chmod(const char *path, mode_t mode) {
-	Entry entry = Entry(0, 0).getEntry(path);
+	StatTimer timer(filesystem.stats.ops[OP_CHMOD]);
+	if (isStats(path)) {
+		return -EACCES;
+	}
+	/* operasi ini tidak mengubah isi direktori */
+	RWGuard guard(filesystem.namespaceLock, false);
+	Transaction transaction;
+	Entry entry = filesystem.lookup(path);
 
 	if(entry.isEmpty()){
 		return -ENOENT;
 	}
+	FileLock lock(entry, true);
+	entry = Entry(entry.position, entry.offset);
 
-	// masukkan atribut baru
-	entry.setAttr(mode & 0x7);
+	// masukkan atribut baru, bit direktori tetap
+	entry.setAttr((entry.getAttr() & ~0x7) | (mode & 0x7));
 	entry.write();
 	return 0;
 }
@@ -330,40 +834,86 @@ int poi_chmod(const char *path, mode_t mode) {
  * Membuat hard link ke sebuah file
  * @param  path    [description]
  * @param  newpath [description]
- * @return         [description]
+ * @return         -ENOSPC jika isi harus disalin dan blok kosong tidak
+ *                 cukup, newpath tidak dibuat
  */
 int poi_link(const char *path, const char *newpath) {
-	Entry oldentry = Entry(0,0).getEntry(path);
+	StatTimer timer(filesystem.stats.ops[OP_LINK]);
+	if (isStats(path) || isStats(newpath)) {
+		return -EACCES;
+	}
+	/* operasi ini mengubah isi direktori */
+	RWGuard guard(filesystem.namespaceLock, true);
+	Transaction transaction;
+	Entry oldentry = filesystem.lookup(path);
 
 	/* kalo nama kosong */
 	if(oldentry.isEmpty()){
 		return -ENOENT;
 	}
+	/* cari parent dari newpath */
+	int i;
+	Directory parent;
+	for (i = strlen(newpath) - 1; newpath[i] != '/'; i--);
+	if (getDirectory(string(newpath, i).c_str(), parent) != 0) {
+		return -ENOENT;
+	}
+	if (!parent.find(newpath + i + 1).isEmpty()) {
+		return -EEXIST;
+	}
+
 	/* buat entry baru dengan nama newpath */
-	Entry newentry = Entry(0,0).getNewEntry(newpath);
+	Entry newentry = parent.emptySlot(newpath + i + 1);
+	oldentry = filesystem.lookup(path);
 	/* set atribut untuk newpath */
+	newentry.setName(newpath + i + 1);
 	newentry.setAttr(oldentry.getAttr());
 	newentry.setCurrentDateTime();
-	newentry.setSize(oldentry.getSize());
-	newentry.write();
+	newentry.setSize(0);
+	filesystem.initFile(newentry);
 
-	/* copy isi file */
-	char buffer[512];
-	/* lakukan per 4096 byte */
-	int totalsize = oldentry.getSize();
-	int offset = 0;
-	while (totalsize > 0) {
-		int sizenow = totalsize;
-		if (sizenow > 512) {
-			sizenow = 512;
+	/* format v2: blok dipakai bersama (copy-on-write), tanpa menyalin isi */
+	if (filesystem.cloneFile(oldentry, newentry)) {
+		newentry.write();
+		filesystem.dentry.invalidate(newpath);
+		return 0;
+	}
+	newentry.write();
+	filesystem.dentry.invalidate(newpath);
+
+	/* copy isi file, blok kosong diperiksa dulu agar salinan tidak
+	   berhenti di tengah */
+	FileHandle source, target;
+	source.entry = oldentry;
+	target.entry = newentry;
+	int chunk = max(filesystem.blockSize, LINK_COPY_SIZE / filesystem.blockSize * filesystem.blockSize);
+	vector<char> buffer(chunk);
+	off_t totalsize = oldentry.getSize();
+	off_t offset = 0;
+	int result = 0;
+	if ((totalsize + filesystem.blockSize - 1) / filesystem.blockSize > (off_t)filesystem.available) {
+		result = -ENOSPC;
+	}
+	while (totalsize > 0 && result == 0) {
+		int sizenow = min(totalsize, (off_t)chunk);
+		int done = filesystem.readFile(source, &buffer[0], sizenow, offset);
+		if (done == sizenow) {
+			done = filesystem.writeFile(target, &buffer[0], sizenow, offset);
+		}
+		if (done != sizenow) {
+			result = done < 0 ? done : -EIO;
 		}
-		filesystem.readBlock(oldentry.getIndex(), buffer, oldentry.getSize(), offset);
-		filesystem.writeBlock(newentry.getIndex(), buffer, newentry.getSize(), offset);
 		totalsize -= sizenow;
-		offset += 512;
+		offset += sizenow;
 	}
 
-	return 0;
+	/* salinan yang tidak lengkap dihapus */
+	if (result < 0) {
+		filesystem.releaseFile(target.entry);
+		target.entry.makeEmpty();
+		filesystem.dentry.invalidate(newpath);
+	}
+	return result;
 }
 
 /**
@@ -373,13 +923,49 @@ int poi_link(const char *path, const char *newpath) {
  * @return      [description]
  */
 int poi_open(const char* path, struct fuse_file_info* fi) {
-	/* hanya mengecek apakah file ada atau tidak */
-
-	Entry entry = Entry(0,0).getEntry(path);
+	StatTimer timer(filesystem.stats.ops[OP_OPEN]);
+	/* isi statistik diambil sekali agar pembacaan bertahap konsisten */
+	if (isStats(path)) {
+		if ((fi->flags & O_ACCMODE) != O_RDONLY) {
+			return -EACCES;
+		}
+		fi->fh = (uint64_t)(uintptr_t)new string(filesystem.stats.report());
+		fi->direct_io = 1;
+		return 0;
+	}
+	/* operasi ini tidak mengubah isi direktori */
+	RWGuard guard(filesystem.namespaceLock, false);
+	Entry entry = filesystem.lookup(path);
 
 	if(entry.isEmpty()) {
 		return -ENOENT;
 	}
+
+	/* simpan lokasi entry dan cursor rantai di handle */
+	fi->fh = (uint64_t)(uintptr_t)filesystem.handles.open(entry);
+	/* isi yang diubah di luar kernel dibaca langsung sampai ukuran
+	   di cache atribut kernel kedaluwarsa */
+	bool direct;
+	fi->keep_cache = keepKernelCache(path, direct);
+	fi->direct_io = direct;
+	return 0;
+}
+
+/**
+ * Menutup file yang dibuka dengan poi_open
+ * @param  path [description]
+ * @param  fi   [description]
+ * @return      [description]
+ */
+int poi_release(const char* path, struct fuse_file_info* fi) {
+	StatTimer timer(filesystem.stats.ops[OP_RELEASE]);
+	if (isStats(path)) {
+		delete (string*)(uintptr_t)fi->fh;
+		fi->fh = 0;
+		return 0;
+	}
+	filesystem.handles.release((FileHandle*)(uintptr_t)fi->fh);
+	fi->fh = 0;
 	return 0;
 }
 
@@ -391,13 +977,188 @@ int poi_open(const char* path, struct fuse_file_info* fi) {
  * @return      [description]
  */
 int poi_utimens(const char *path, const timespec tv[2]) {
-	Entry entry = Entry(0,0).getEntry(path);
+	StatTimer timer(filesystem.stats.ops[OP_UTIMENS]);
+	if (isStats(path)) {
+		return -EACCES;
+	}
+	/* operasi ini tidak mengubah isi direktori */
+	RWGuard guard(filesystem.namespaceLock, false);
+	Transaction transaction;
+	Entry entry = filesystem.lookup(path);
 
 	if(entry.isEmpty()) {
 		return -ENOENT;
 	}
+	FileLock lock(entry, true);
+	entry = Entry(entry.position, entry.offset);
 
 	entry.setCurrentDateTime();
 	entry.write();
 	return 0;
 }
+
+/**
+ * Memesan blok untuk rentang file, atau mengosongkannya dengan
+ * FALLOC_FL_PUNCH_HOLE
+ * @param  path   [description]
+ * @param  mode   FALLOC_FL_KEEP_SIZE dan/atau FALLOC_FL_PUNCH_HOLE
+ * @param  offset [description]
+ * @param  length [description]
+ * @param  fi     [description]
+ * @return        -ENOSPC jika blok kosong tidak cukup
+ */
+int poi_fallocate(const char *path, int mode, off_t offset, off_t length, struct fuse_file_info *fi) {
+	StatTimer timer(filesystem.stats.ops[OP_FALLOCATE]);
+	if (isStats(path)) {
+		return -EACCES;
+	}
+	/* hole hanya bisa dibuat tanpa mengubah ukuran file */
+	if ((mode & ~(FALLOC_FL_KEEP_SIZE | FALLOC_FL_PUNCH_HOLE)) != 0
+		|| ((mode & FALLOC_FL_PUNCH_HOLE) && !(mode & FALLOC_FL_KEEP_SIZE))) {
+		return -EOPNOTSUPP;
+	}
+	if (offset < 0 || length <= 0) {
+		return -EINVAL;
+	}
+	if (offset + length > filesystem.maxFileSize()) {
+		return -EFBIG;
+	}
+	/* operasi ini tidak mengubah isi direktori */
+	RWGuard guard(filesystem.namespaceLock, false);
+	Transaction transaction;
+	FileHandle temp;
+	FileHandle *handle = getHandle(path, fi, temp);
+
+	if (handle->entry.isEmpty()) {
+		return -ENOENT;
+	}
+	if (handle->entry.getAttr() & 0x8) {
+		return -EISDIR;
+	}
+	FileLock lock(handle->entry, true);
+	refreshHandle(handle, temp);
+
+	if (mode & FALLOC_FL_PUNCH_HOLE) {
+		filesystem.punchFile(*handle, offset, length);
+	}
+	else if (!filesystem.preallocateFile(*handle, offset, length, mode & FALLOC_FL_KEEP_SIZE)) {
+		return -ENOSPC;
+	}
+	return 0;
+}
+
+/**
+ * Ioctl pada file yang dibuka. POI_IOC_CLONE mengganti isi file ini
+ * dengan salinan copy-on-write file sumber (format v2)
+ * @param  path  [description]
+ * @param  cmd   [description]
+ * @param  arg   [description]
+ * @param  fi    [description]
+ * @param  flags [description]
+ * @param  data  struct poi_clone_args dari pemanggil
+ * @return       -EMLINK jika jumlah referensi blok maksimum tercapai
+ */
+int poi_ioctl(const char *path, int cmd, void *arg, struct fuse_file_info *fi, unsigned int flags, void *data) {
+	StatTimer timer(filesystem.stats.ops[OP_IOCTL]);
+	if ((unsigned int)cmd != POI_IOC_CLONE) {
+		return -ENOTTY;
+	}
+	struct poi_clone_args *args = (struct poi_clone_args*)data;
+	args->source[sizeof(args->source) - 1] = '\0';
+	if (isStats(path) || isStats(args->source)) {
+		return -EACCES;
+	}
+	/* sumber tidak boleh berubah selama blok dibagi */
+	RWGuard guard(filesystem.namespaceLock, true);
+	Transaction transaction;
+	Entry source = filesystem.lookup(args->source);
+	FileHandle temp;
+	temp.entry = filesystem.lookup(path);
+
+	if (source.isEmpty() || temp.entry.isEmpty()) {
+		return -ENOENT;
+	}
+	if ((source.getAttr() & 0x8) || (temp.entry.getAttr() & 0x8)) {
+		return -EISDIR;
+	}
+	if (filesystem.version != VOLUME_VERSION_EXTENT) {
+		return -EOPNOTSUPP;
+	}
+	if (source.position == temp.entry.position && source.offset == temp.entry.offset) {
+		return 0;
+	}
+
+	/* referensi blok sumber diambil dulu pada salinan entry, isi lama
+	   target baru dilepas setelah berhasil agar target tetap utuh jika
+	   jumlah referensi maksimum tercapai */
+	Entry clone = temp.entry;
+	if (!filesystem.cloneFile(source, clone)) {
+		return -EMLINK;
+	}
+	filesystem.truncateFile(temp, 0);
+	memcpy(temp.entry.data, clone.data, ENTRY_MAX_SIZE);
+	temp.entry.setCurrentDateTime();
+	temp.entry.write();
+
+	/* kernel tidak tahu isi file berubah */
+	invalidateKernel(path);
+	return 0;
+}
+
+/**
+ * Menyinkronkan isi file ke volume
+ * @param  path     [description]
+ * @param  datasync [description]
+ * @param  fi       [description]
+ * @return          [description]
+ */
+int poi_fsync(const char *path, int datasync, struct fuse_file_info *fi) {
+	StatTimer timer(filesystem.stats.ops[OP_FSYNC]);
+	filesystem.flush();
+	return 0;
+}
+
+/**
+ * Dipanggil saat mount, meminta splice untuk read_buf/write_buf dan
+ * penulisan sampai KERNEL_IO_MAX per permintaan
+ * @param  conn kemampuan koneksi fuse
+ * @return      private_data
+ */
+void *poi_init(struct fuse_conn_info *conn) {
+	conn->want |= conn->capable & (FUSE_CAP_SPLICE_READ | FUSE_CAP_SPLICE_WRITE | FUSE_CAP_SPLICE_MOVE);
+	conn->want |= conn->capable & FUSE_CAP_BIG_WRITES;
+	conn->max_write = KERNEL_IO_MAX;
+
+	/* thread dibuat setelah fuse berjalan di background */
+	if (filesystem.defrag.enabled) {
+		filesystem.defrag.start();
+	}
+	if (filesystem.durability != DURABILITY_OP && filesystem.syncInterval > 0) {
+		filesystem.flusher.start();
+	}
+	return NULL;
+}
+
+/**
+ * Dipanggil saat unmount, menyinkronkan dan menutup volume
+ * lalu mencetak statistik cache
+ * @param private_data [description]
+ */
+void poi_destroy(void *private_data) {
+	filesystem.defrag.stop();
+	filesystem.flusher.stop();
+	RWGuard guard(filesystem.namespaceLock, true);
+	filesystem.close();
+
+	fprintf(stderr, "dentry: hits=%lu negative=%lu misses=%lu evictions=%lu\n",
+		filesystem.dentry.hits, filesystem.dentry.negativeHits,
+		filesystem.dentry.misses, filesystem.dentry.evictions);
+	fprintf(stderr, "cache: hit_ratio=%.3f hits=%lu misses=%lu evictions=%lu writebacks=%lu dirty_bytes=%lu\n",
+		filesystem.cache.hitRatio(), filesystem.cache.hits, filesystem.cache.misses,
+		filesystem.cache.evictions, filesystem.cache.writebacks, (unsigned long)filesystem.cache.dirtyBytes);
+	fprintf(stderr, "readahead: prefetched=%lu hits=%lu wasted=%lu\n",
+		filesystem.cache.prefetched, filesystem.cache.readaheadHits, filesystem.cache.readaheadWasted);
+	fprintf(stderr, "metadata: writes=%lu\n", filesystem.metadataWrites);
+	fprintf(stderr, "journal: commits=%lu overflows=%lu replays=%lu\n",
+		filesystem.journal.commits, filesystem.journal.overflows, filesystem.journal.replays);
+}
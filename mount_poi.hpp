@@ -7,10 +7,13 @@
 #define FUSE_USE_VERSION 29 // versi fuse yang digunakan 2.9.3
 
 #include <errno.h>
+#include <fcntl.h>
 #include <fuse.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
+#include <sys/ioctl.h>
 
 #include "poi.hpp" // filesystem
 
@@ -23,11 +26,11 @@
  * */
 int poi_getattr(const char* path, struct stat* stbuf);
 
-/** Membaca directory
+/** Membaca directory, dapat dilanjutkan dari offset entry terakhir
  * @param path
  * @param buffer
  * @param filler
- * @param offset
+ * @param offset posisi sesudah entry terakhir yang diterima, 0 dari awal
  * @param file_info
  * @return 0 jika tidak terjadi error
  * */
@@ -57,10 +60,20 @@ int poi_mknod(const char *path, mode_t mode, dev_t dev);
  * */
 int poi_read(const char *path,char *buf, size_t size,off_t offset, struct fuse_file_info *fi);
 
-/** Menghapus sebuah directory
+/** Membaca data file sebagai potongan descriptor volume (tanpa salinan)
  * @param path
+ * @param bufp
+ * @param size
+ * @param offset
+ * @param file_info
  * @return 0 jika tidak terjadi error
  * */
+int poi_read_buf(const char *path, struct fuse_bufvec **bufp, size_t size, off_t offset, struct fuse_file_info *fi);
+
+/** Menghapus sebuah directory
+ * @param path
+ * @return 0 jika tidak terjadi error, -ENOTEMPTY jika directory masih berisi
+ * */
 int poi_rmdir(const char *path);
 
 /** Menghapus file
@@ -72,7 +85,7 @@ int poi_unlink(const char *path);
 /** Mengubah nama file
  * @param path
  * @param newpath
- * @return 0 jika tidak terjadi error
+ * @return 0 jika tidak terjadi error, -ENOTEMPTY jika newpath directory yang masih berisi
  * */
 int poi_rename(const char* path, const char* newpath);
 
@@ -86,6 +99,15 @@ int poi_rename(const char* path, const char* newpath);
  * */
 int poi_write(const char *path, const char *buf, size_t size, off_t offset, struct fuse_file_info *fi);
 
+/** Menulis data dari bufvec fuse langsung ke volume (tanpa salinan)
+ * @param path
+ * @param buffer
+ * @param offset
+ * @param file_info
+ * @return jumlah byte yang tertulis
+ * */
+int poi_write_buf(const char *path, struct fuse_bufvec *buf, off_t offset, struct fuse_file_info *fi);
+
 /** Mengubah ukuran dari sebuah file yang telah terbuka
  * @param path
  * @param newsize
@@ -113,13 +135,22 @@ int poi_chmod(const char *path, mode_t mode);
 int poi_link(const char *path, const char *newpath);
 
 /**
- * Membuka file untuk memungkinkan operasi pada file
+ * Membuka file untuk memungkinkan operasi pada file; page cache kernel
+ * dipakai ulang kecuali isi file diubah di luar kernel (ioctl clone)
  * @param path
  * @param fi file info
  * @return
  */
 int poi_open(const char* path, struct fuse_file_info* fi);
 
+/**
+ * Menutup file yang dibuka dengan poi_open
+ * @param path
+ * @param fi file info
+ * @return
+ */
+int poi_release(const char* path, struct fuse_file_info* fi);
+
 /* Other dependencies */
 /**
  * Mengubah waktu modifikasi dan/atau akses
@@ -128,3 +159,60 @@ int poi_open(const char* path, struct fuse_file_info* fi);
  * @return      [description]
  */
 int poi_utimens(const char *path, const timespec tv[2]);
+
+/**
+ * Menyinkronkan isi file ke volume
+ * @param path
+ * @param datasync
+ * @param fi file info
+ * @return
+ */
+int poi_fsync(const char *path, int datasync, struct fuse_file_info *fi);
+
+/**
+ * Memesan blok untuk rentang file, atau mengosongkannya dengan
+ * FALLOC_FL_PUNCH_HOLE
+ * @param path
+ * @param mode FALLOC_FL_KEEP_SIZE dan/atau FALLOC_FL_PUNCH_HOLE
+ * @param offset
+ * @param length
+ * @param fi file info
+ * @return
+ */
+int poi_fallocate(const char *path, int mode, off_t offset, off_t length, struct fuse_file_info *fi);
+
+/* argumen ioctl POI_IOC_CLONE: path file sumber di dalam volume */
+struct poi_clone_args {
+	char source[1024];
+};
+#define POI_IOC_CLONE _IOW('P', 1, struct poi_clone_args)
+
+/**
+ * Ioctl pada file yang dibuka. POI_IOC_CLONE mengganti isi file ini
+ * dengan salinan copy-on-write file sumber (format v2); sampai atribut
+ * lama di kernel kedaluwarsa file dibuka tanpa page cache kernel
+ * @param path
+ * @param cmd
+ * @param arg
+ * @param fi file info
+ * @param flags
+ * @param data argumen dari pemanggil
+ * @return -EMLINK jika jumlah referensi blok maksimum tercapai, isi
+ *         file ini tidak berubah
+ */
+int poi_ioctl(const char *path, int cmd, void *arg, struct fuse_file_info *fi, unsigned int flags, void *data);
+
+/**
+ * Dipanggil saat mount, meminta splice dan big writes dari kernel dan
+ * menjalankan defragmentasi latar belakang jika diminta
+ * @param conn
+ * @return
+ */
+void *poi_init(struct fuse_conn_info *conn);
+
+/**
+ * Dipanggil saat unmount, menyinkronkan dan menutup volume
+ * lalu mencetak statistik cache
+ * @param private_data
+ */
+void poi_destroy(void *private_data);
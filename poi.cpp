@@ -4,6 +4,8 @@
 //////////////////////////////
 
 #include <stdexcept> 		// c++ exception
+#include <fcntl.h>
+#include <unistd.h>
 #include "poi.hpp"
 
 /* Global filesystem */
@@ -15,322 +17,1923 @@ extern POI filesystem;
 /**
  * Konstruktor
  */
-POI::POI(){
+POI::POI() : metaLock(true) {
 	time(&mount_time);
+	flags = 0;
+	version = VOLUME_VERSION_FAT;
+	setGeometry(POI_BLOCK_SIZE, POINTER_WIDTH, N_BLOCK);
+	chainGeneration = 0;
+	extentGeneration = 0;
+	sharedBlocks = 0;
+	storage = NULL;
+	backend = BACKEND_STREAM;
+	headerDirty = false;
+	syncInterval = METADATA_SYNC_INTERVAL;
+	lastSync = mount_time;
+	metadataWrites = 0;
+	durability = DURABILITY_NONE;
+	kernelTimeout = 0;
+	readaheadMax = READAHEAD_MAX;
+	ioDepth = URING_DEPTH;
 }
 
 /**
  * Destruktor
  */
 POI::~POI(){
-	file.close();
+	close();
 }
 
 /**
  * Buat file *.poi baru
- * @param filename nama file
+ * @param filename     nama file
+ * @param flags        fitur volume
+ * @param version      versi format (FAT atau extent)
+ * @param blockSize    ukuran blok, pangkat dua antara 512 dan 65536
+ * @param pointerWidth lebar pointer blok, 2 atau 4 byte
+ * @param blocks       jumlah blok, 0 untuk N_BLOCK (format v2 16 bit
+ *                     selalu menyisakan SHARE_RESERVE nilai pointer)
  */
-void POI::create(const char *filename){
+void POI::create(const char *filename, int flags, int version, int blockSize, int pointerWidth, Block blocks){
+	if (blockSize < POI_BLOCK_SIZE || blockSize > POI_BLOCK_SIZE_MAX || (blockSize & (blockSize - 1)) != 0) {
+		throw runtime_error("Ukuran blok harus pangkat dua antara 512 dan 65536");
+	}
+	if (pointerWidth != 2 && pointerWidth != 4) {
+		throw runtime_error("Lebar pointer harus 16 atau 32 bit");
+	}
+	if (blocks == 0) {
+		blocks = N_BLOCK;
+	}
+	/* nilai pointer teratas dipakai sebagai jumlah referensi blok bersama */
+	if (version == VOLUME_VERSION_EXTENT && pointerWidth == 2) {
+		blocks = min(blocks, (Block)(N_BLOCK - SHARE_RESERVE));
+	}
+	if (blocks < 2 || (pointerWidth == 2 && blocks > N_BLOCK) || blocks == END_BLOCK) {
+		throw runtime_error("Jumlah blok tidak muat di pointer volume");
+	}
+	if ((flags & VOLUME_INLINE_DATA) && version != VOLUME_VERSION_EXTENT) {
+		throw runtime_error("Isi inline hanya untuk format 2");
+	}
 
-	/* buka file dengan mode input-output, binary dan truncate (untuk membuat file baru) */
-	file.open(filename, fstream::in | fstream::out | fstream::binary | fstream::trunc);
+	/* volume dengan direktori hashed juga memakai root hashed */
+	this->flags = flags;
+	if (flags & VOLUME_HASHED_DIRS) {
+		this->flags |= VOLUME_HASHED_ROOT;
+	}
+	this->version = version;
+	setGeometry(blockSize, pointerWidth, blocks);
+
+	/* buat file baru (truncate), seluruh volume langsung berukuran penuh
+	   sebagai sparse file sehingga blok kosong tidak perlu ditulis */
+	int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0666);
+	if (fd < 0) {
+		throw runtime_error("File volume tidak dapat dibuat");
+	}
+	if (ftruncate(fd, blockOffset(capacity)) != 0) {
+		::close(fd);
+		throw runtime_error("Ukuran volume tidak dapat diatur");
+	}
+	::close(fd);
+	StreamStorage file(filename);
 
 	/* Buat Volume Information */
-	initVolumeInformation(filename);
+	initVolumeInformation(file, filename);
 
 	/* Buat Allocation Table */
-	initAllocationTable();
+	initAllocationTable(file);
 
 	/* Buat Data Pool */
-	initDataPool();
+	initDataPool(file);
+}
+
+/**
+ * Mengatur geometri volume dan ukuran yang diturunkan darinya
+ * @param blockSize    ukuran blok dalam byte
+ * @param pointerWidth lebar pointer blok di volume
+ * @param blocks       jumlah blok volume
+ */
+void POI::setGeometry(int blockSize, int pointerWidth, Block blocks) {
+	this->blockSize = blockSize;
+	this->pointerWidth = pointerWidth;
+	pointerPerBlock = blockSize / pointerWidth;
+	capacity = blocks;
+	fatBlocks = ((unsigned long long)blocks * pointerWidth + blockSize - 1) / blockSize;
+
+	/* entry lebar menyimpan index 32 bit dan ukuran 64 bit */
+	entryBase = (pointerWidth == 2) ? ENTRY_SIZE : ENTRY_SIZE_WIDE;
+	entrySize = (version == VOLUME_VERSION_EXTENT) ? entryBase * 2 : entryBase;
+
+	/* entry v2 yang diperbesar, isi inline dimulai setelah ukuran file */
+	inlineOffset = entryBase == ENTRY_SIZE ? ENTRY_SIZE : ENTRY_WIDE_SIZE + 8;
+	inlineCapacity = 0;
+	if (version == VOLUME_VERSION_EXTENT && (flags & VOLUME_INLINE_DATA)) {
+		entrySize = ENTRY_INLINE_SIZE;
+		inlineCapacity = entrySize - inlineOffset;
+	}
+	entryPerBlock = blockSize / entrySize;
 
-	file.close();
 }
 
 /**
  * Inisialisasi Volume Information
+ * @param file     file yang sedang dibuat
  * @param filename nama file
  */
-void POI::initVolumeInformation(const char *filename) {
-	/* buffer untuk menulis ke file */
-	char buffer[BLOCK_SIZE];
-	memset(buffer, 0, BLOCK_SIZE);
+void POI::initVolumeInformation(Storage &file, const char *filename) {
+	/* buffer untuk menulis ke file, header menempati satu blok */
+	vector<char> block(blockSize, 0);
+	char *buffer = &block[0];
 
 	/* Magic string "poi!" */
 	memcpy(buffer + 0x00, "poi!", 4);
 
-	/* Nama volume */
+	/* Nama volume, dipotong sesuai panjang field */
 	this->filename = string(filename);
-	memcpy(buffer + 0x04, filename, strlen(filename));
+	memcpy(buffer + 0x04, filename, min(strlen(filename), (size_t)HEADER_NAME_SIZE));
 
 	/* Kapasitas filesystem, dalam little endian */
-	capacity = N_BLOCK;
 	memcpy(buffer + 0x24, (char*)&capacity, 4);
 
 	/* Jumlah blok yang belum terpakai, dalam little endian */
-	available = N_BLOCK - 1;
+	available = capacity - 1;
 	memcpy(buffer + 0x28, (char*)&available, 4);
 
 	/* Indeks blok pertama yang bebas, dalam little endian */
 	firstEmpty = 1;
 	memcpy(buffer + 0x2C, (char*)&firstEmpty, 4);
 
+	/* Fitur volume, dalam little endian */
+	memcpy(buffer + 0x30, (char*)&flags, 4);
+
+	/* Versi format volume, dalam little endian */
+	memcpy(buffer + 0x34, (char*)&version, 4);
+
+	/* Ukuran blok dan lebar pointer, dalam little endian */
+	memcpy(buffer + 0x38, (char*)&blockSize, 4);
+	memcpy(buffer + 0x3C, (char*)&pointerWidth, 4);
+
+	/* Penanda field 0x30-0x47 */
+	memcpy(buffer + 0x48, HEADER_MARK, 4);
+
 	/* String "!iop" */
 	memcpy(buffer + 0x1FC, "!iop", 4);
 
-	file.write(buffer, BLOCK_SIZE);
+	file.write(0, buffer, blockSize);
+}
+
+/**
+ * Inisialisasi Allocation Table, hanya blok pertama yang ditulis
+ * karena sisanya bernilai EMPTY_BLOCK (nol, bagian sparse file)
+ * @param file file yang sedang dibuat
+ */
+void POI::initAllocationTable(Storage &file) {
+	vector<char> buffer(blockSize, 0);
+
+	/* root ada, lainnya belum ada */
+	setPointer(&buffer[0], END_BLOCK);
+	file.write(blockSize, &buffer[0], blockSize);
+}
+
+/**
+ * Inisialisasi Data Pool, blok kosong sudah bernilai nol
+ * @param file file yang sedang dibuat
+ */
+void POI::initDataPool(Storage &file) {
+	/* root hashed diawali tabel bucket yang semuanya kosong */
+	vector<char> buffer(blockSize, (flags & VOLUME_HASHED_ROOT) ? 0xFF : 0);
+	file.write(blockOffset(0), &buffer[0], blockSize);
+}
+
+/**
+ * Baca file poi
+ * @param filename nama file
+ */
+void POI::load(const char *filename){
+	/* buka file dengan backend yang dipilih, exception jika file tidak ada */
+	if (backend == BACKEND_MMAP) {
+		storage = new MmapStorage(filename);
+
+		/* pemetaan sudah berada di memori, cache blok tidak diperlukan */
+		cache.setBudget(0);
+	}
+	else if (backend == BACKEND_URING) {
+		storage = new UringStorage(filename, ioDepth);
+	}
+	else {
+		storage = new StreamStorage(filename);
+	}
+
+	/* periksa Volume Information, header bisa berubah oleh journal */
+	readVolumeInformation();
+	if (journal.replay()) {
+		readVolumeInformation();
+	}
+
+	/* baca Allocation Table */
+	readAllocationTable();
+
+	/* bitmap blok bebas dibangun dari allocation table */
+	allocator.load(&nextBlock[0], capacity);
+	available = allocator.count();
+	firstEmpty = allocator.first();
+
+	/* journal sesuai mode durabilitas */
+	openJournal();
+}
+
+/**
+ * Memastikan semua perubahan sampai ke file .poi
+ */
+void POI::flush() {
+	RWGuard guard(commitLock, true);
+	if (storage != NULL) {
+		/* isi blok dulu, lalu allocation table, terakhir header */
+		cache.flush();
+		unsigned long commits = journal.commits;
+		flushMetadata();
+
+		/* commit journal sudah melakukan fsync */
+		if (journal.commits == commits) {
+			storage->sync();
+		}
+	}
+}
+
+/**
+ * Menutup file .poi
+ */
+void POI::close() {
+	flush();
+	cache.clear();
+	journal.enable(false);
+	journal.attach(0, 0);
+	delete storage;
+	storage = NULL;
+}
+
+/**
+ * Membaca Volume Information
+ */
+void POI::readVolumeInformation() {
+	char buffer[HEADER_SIZE];
+
+	/* Baca keseluruhan Volume Information, bagian yang berisi field */
+	if (storage->size() < HEADER_SIZE) {
+		close();
+		throw runtime_error("File bukan file POI yang valid");
+	}
+	storage->read(0, buffer, HEADER_SIZE);
+
+	/* cek magic string di awal dan string "!iop" di akhir */
+	if (string(buffer, 4) != "poi!" || string(buffer + 0x1FC, 4) != "!iop") {
+		close();
+		throw runtime_error("File bukan file POI yang valid");
+	}
+
+	/* baca nama volume agar tetap sama saat header ditulis ulang */
+	filename = string(buffer + 0x04, strnlen(buffer + 0x04, HEADER_NAME_SIZE));
+
+	/* baca capacity */
+	Block blocks;
+	memcpy((char*)&blocks, buffer + 0x24, 4);
+
+	/* baca available */
+	memcpy((char*)&available, buffer + 0x28, 4);
+
+	/* baca firstEmpty */
+	memcpy((char*)&firstEmpty, buffer + 0x2C, 4);
+
+	/* volume lama tanpa HEADER_MARK memakai nilai bawaan untuk field
+	   0x30-0x47; nama file yang panjang bisa tertulis sampai ke sana */
+	bool marked = string(buffer + 0x48, 4) == HEADER_MARK;
+	flags = 0;
+	version = VOLUME_VERSION_FAT;
+	int size = POI_BLOCK_SIZE;
+	int width = POINTER_WIDTH;
+	Block journalStart = 0, journalBlocks = 0;
+
+	if (marked) {
+		/* baca flags */
+		memcpy((char*)&flags, buffer + 0x30, 4);
+
+		/* baca versi format */
+		memcpy((char*)&version, buffer + 0x34, 4);
+		if (version < VOLUME_VERSION_FAT || version > VOLUME_VERSION_EXTENT) {
+			close();
+			throw runtime_error("Versi format POI tidak didukung");
+		}
+
+		/* baca geometri dan lokasi journal (0 jika tanpa journal) */
+		memcpy((char*)&size, buffer + 0x38, 4);
+		memcpy((char*)&width, buffer + 0x3C, 4);
+		memcpy((char*)&journalStart, buffer + 0x40, 4);
+		memcpy((char*)&journalBlocks, buffer + 0x44, 4);
+	}
+	if (size < POI_BLOCK_SIZE || size > POI_BLOCK_SIZE_MAX || (size & (size - 1)) != 0
+		|| (width != 2 && width != 4) || (width == 2 && blocks > N_BLOCK)) {
+		close();
+		throw runtime_error("Geometri volume POI tidak valid");
+	}
+
+	/* ukuran entry dan allocation table mengikuti versi dan geometri */
+	setGeometry(size, width, blocks);
+
+	/* lokasi journal */
+	if (journalStart != 0 && (journalStart >= blocks || journalBlocks > blocks - journalStart)) {
+		close();
+		throw runtime_error("Lokasi journal POI tidak valid");
+	}
+	journal.attach(journalStart, journalBlocks);
+
+	/* file harus memuat seluruh data pool */
+	if (blocks < 2 || storage->size() < blockOffset(capacity)) {
+		close();
+		throw runtime_error("Ukuran file POI tidak sesuai kapasitas");
+	}
+}
+
+/**
+ * Membaca Allocation Table per potongan besar, lalu memeriksa
+ * setiap pointer menunjuk blok di dalam volume
+ */
+void POI::readAllocationTable() {
+	nextBlock.assign(capacity, EMPTY_BLOCK);
+	fatDirty.assign(fatBlocks, false);
+
+	if (pointerWidth == sizeof(Block)) {
+		/* pointer 32 bit little endian langsung dibaca ke nextBlock,
+		   per potongan agar tiap pembacaan tetap terbatas */
+		Block perChunk = FAT_READ_CHUNK / pointerWidth;
+		for (Block i = 0; i < capacity; i += perChunk) {
+			Block count = min(perChunk, capacity - i);
+			storage->read(blockSize + (off_t)i * pointerWidth, (char*)&nextBlock[i], (size_t)count * pointerWidth);
+		}
+	}
+	else {
+		/* pointer 16 bit dibaca per potongan lalu diperlebar */
+		vector<char> buffer(FAT_READ_CHUNK);
+		Block perChunk = FAT_READ_CHUNK / pointerWidth;
+		for (Block i = 0; i < capacity; i += perChunk) {
+			Block count = min(perChunk, capacity - i);
+			storage->read(blockSize + (off_t)i * pointerWidth, &buffer[0], (size_t)count * pointerWidth);
+			for (Block j = 0; j < count; j++) {
+				nextBlock[i + j] = getPointer(&buffer[j * pointerWidth]);
+			}
+		}
+	}
+
+	/* root selalu terpakai, pointer lain kosong, akhir rantai, di dalam
+	   volume, atau (format v2) jumlah referensi blok yang dipakai bersama */
+	bool valid = nextBlock[0] != EMPTY_BLOCK;
+	Block shared = 0;
+	for (Block i = 0; i < capacity && valid; i++) {
+		if (nextBlock[i] != END_BLOCK && nextBlock[i] >= capacity) {
+			valid = version == VOLUME_VERSION_EXTENT;
+			shared++;
+		}
+	}
+	sharedBlocks = shared;
+	if (!valid) {
+		close();
+		throw runtime_error("Allocation table POI rusak");
+	}
+}
+
+/**
+ * Menandai Volume Information berubah, ditulis oleh flushMetadata
+ */
+void POI::writeVolumeInformation() {
+	MutexGuard guard(metaLock);
+	headerDirty = true;
+	metadataChanged();
+}
+
+/**
+ * Menandai Allocation Table pada posisi tertentu berubah,
+ * ditulis per blok oleh flushMetadata
+ * @param position posisi pointer blok
+ */
+void POI::writeAllocationTable(Block position) {
+	fatDirty[position / pointerPerBlock] = true;
+	metadataChanged();
+}
+
+/**
+ * Menulis metadata jika interval sinkronisasi sudah lewat, selain itu
+ * oleh flusher; dengan journal, commit ditunda sampai operasi selesai
+ * (endOperation)
+ */
+void POI::metadataChanged() {
+	if (storage == NULL || journal.active()) {
+		return;
+	}
+	if (syncInterval == 0 || time(NULL) - lastSync >= syncInterval) {
+		/* blok data yang dirujuk metadata ditulis lebih dulu */
+		cache.flush();
+		flushMetadata();
+	}
+}
+
+/**
+ * Menulis metadata yang berubah ke volume. Tanpa journal, allocation
+ * table ditulis lebih dulu dan header terakhir karena header merujuknya;
+ * dengan journal, semuanya menjadi satu group commit.
+ */
+void POI::flushMetadata() {
+	MutexGuard guard(metaLock);
+	vector<MetadataWrite> writes;
+	collectMetadata(writes);
+
+	if (journal.active()) {
+		journal.commit(writes);
+	}
+	else {
+		for (size_t i = 0; i < writes.size(); i++) {
+			storage->write(writes[i].position, &writes[i].data[0], writes[i].data.size());
+			metadataWrites++;
+		}
+	}
+
+	lastSync = time(NULL);
+}
+
+/**
+ * Menyusun blok Allocation Table yang berubah, blok berurutan
+ * digabung dalam satu penulisan, kemudian Volume Information
+ * @param writes penulisan yang harus dilakukan, header terakhir
+ */
+void POI::collectMetadata(vector<MetadataWrite> &writes) {
+	Block i = 0;
+	while (i < fatDirty.size()) {
+		if (!fatDirty[i]) {
+			i++;
+			continue;
+		}
+
+		Block j = i;
+		while (j < fatDirty.size() && fatDirty[j]) {
+			fatDirty[j++] = false;
+		}
+
+		/* pointer disusun ulang sesuai lebar pointer di volume */
+		MetadataWrite write;
+		write.position = blockSize + (off_t)i * blockSize;
+		write.data.assign((size_t)(j - i) * blockSize, 0);
+		Block last = min((unsigned long long)capacity, (unsigned long long)j * pointerPerBlock);
+		for (Block k = i * pointerPerBlock; k < last; k++) {
+			setPointer(&write.data[(size_t)(k - i * pointerPerBlock) * pointerWidth], nextBlock[k]);
+		}
+		writes.push_back(write);
+		i = j;
+	}
+
+	if (headerDirty) {
+		/* buffer untuk menulis ke file */
+		MetadataWrite write;
+		write.position = 0x00;
+		write.data.assign(HEADER_SIZE, 0);
+		char *buffer = &write.data[0];
+
+		/* Magic string "POI" */
+		memcpy(buffer + 0x00, "poi!", 4);
+
+		/* Nama volume, dipotong sesuai panjang field */
+		memcpy(buffer + 0x04, filename.c_str(), min(filename.length(), (size_t)HEADER_NAME_SIZE));
+
+		/* Kapasitas filesystem, dalam little endian */
+		memcpy(buffer + 0x24, (char*)&capacity, 4);
+
+		/* Jumlah blok yang belum terpakai dan indeks blok pertama yang
+		   bebas, dalam little endian, termasuk blok yang dibebaskan
+		   transaksi ini */
+		Block freeCount = available;
+		Block firstFree = firstEmpty;
+		journal.freedSpace(freeCount, firstFree);
+		memcpy(buffer + 0x28, (char*)&freeCount, 4);
+		memcpy(buffer + 0x2C, (char*)&firstFree, 4);
+
+		/* Fitur volume, dalam little endian */
+		memcpy(buffer + 0x30, (char*)&flags, 4);
+
+		/* Versi format volume, dalam little endian */
+		memcpy(buffer + 0x34, (char*)&version, 4);
+
+		/* Ukuran blok dan lebar pointer, dalam little endian */
+		memcpy(buffer + 0x38, (char*)&blockSize, 4);
+		memcpy(buffer + 0x3C, (char*)&pointerWidth, 4);
+
+		/* Lokasi dan panjang journal, dalam little endian */
+		memcpy(buffer + 0x40, (char*)&journal.start, 4);
+		memcpy(buffer + 0x44, (char*)&journal.blocks, 4);
+
+		/* Penanda field 0x30-0x47 */
+		memcpy(buffer + 0x48, HEADER_MARK, 4);
+
+		/* String "!iop" */
+		memcpy(buffer + 0x1FC, "!iop", 4);
+
+		writes.push_back(write);
+		headerDirty = false;
+	}
+}
+
+/**
+ * Membuka journal sesuai mode durabilitas; area journal dibuat
+ * saat pertama kali dibutuhkan. Transaksi lama sudah diputar ulang.
+ */
+void POI::openJournal() {
+	if (durability != DURABILITY_NONE && journal.start == 0) {
+		createJournal();
+	}
+	journal.enable(durability != DURABILITY_NONE);
+}
+
+/**
+ * Mengalokasikan area journal sebagai rantai blok berurutan, besarnya
+ * 1/64 volume dalam batas JOURNAL_MIN_SIZE dan JOURNAL_MAX_SIZE, dan
+ * tidak lebih dari 1/16 blok bebas
+ */
+void POI::createJournal() {
+	unsigned long long size = (unsigned long long)capacity * blockSize / 64;
+	size = max(min(size, (unsigned long long)JOURNAL_MAX_SIZE), (unsigned long long)JOURNAL_MIN_SIZE);
+	int length = min(size / blockSize, (unsigned long long)allocator.count() / 16);
+	if (length < 2) {
+		return;
+	}
+
+	Block start = allocateRun(length);
+	if (length < 2) {
+		freeRange(start, length);
+		return;
+	}
+	for (int i = 0; i < length - 1; i++) {
+		setNextBlock(start + i, start + i + 1);
+	}
+
+	/* blok commit kosong, lalu lokasi journal dicatat di header */
+	journal.attach(start, length);
+	vector<char> buffer(blockSize, 0);
+	storage->write(blockOffset(start), &buffer[0], blockSize);
+	writeVolumeInformation();
+	flushMetadata();
+	storage->sync();
+}
+
+/**
+ * Dipanggil setelah setiap operasi yang mengubah metadata: commit
+ * journal untuk mode per operasi, jika interval sudah lewat, atau jika
+ * transaksi sudah mengisi setengah journal
+ */
+void POI::endOperation() {
+	if (storage == NULL || !journal.active()) {
+		return;
+	}
+	if (durability == DURABILITY_OP || time(NULL) - lastSync >= syncInterval
+		|| journal.pendingBytes() * 2 > journal.capacity()) {
+		flush();
+	}
+}
+
+/**
+ * Dipanggil flusher latar belakang: transaksi journal, atau allocation
+ * table dan header tanpa journal, yang tertunda ditulis setelah
+ * syncInterval walau volume sedang diam
+ */
+void POI::flushExpired() {
+	if (storage == NULL || time(NULL) - lastSync < syncInterval) {
+		return;
+	}
+	bool pending;
+	if (journal.active()) {
+		pending = journal.pendingBytes() > 0;
+	}
+	else {
+		MutexGuard guard(metaLock);
+		pending = headerDirty || find(fatDirty.begin(), fatDirty.end(), true) != fatDirty.end();
+	}
+	if (pending) {
+		flush();
+	}
+}
+
+/**
+ * Ukuran file maksimum, entry sempit menyimpan ukuran 32 bit
+ */
+off_t POI::maxFileSize() {
+	if (pointerWidth == 2) {
+		return 0xFFFFFFFFLL;
+	}
+	return (off_t)blockSize * capacity;
+}
+
+/**
+ * Membaca pointer blok dari data volume
+ * @param  data pointerWidth byte, little endian
+ * @return      END_BLOCK untuk pointer akhir rantai (semua bit 1)
+ */
+Block POI::getPointer(const char *data) {
+	if (pointerWidth == 2) {
+		unsigned short value;
+		memcpy((char*)&value, data, 2);
+		return value == 0xFFFF ? END_BLOCK : value;
+	}
+	Block value;
+	memcpy((char*)&value, data, 4);
+	return value;
+}
+
+/**
+ * Menulis pointer blok ke data volume
+ * @param data  pointerWidth byte, little endian
+ * @param value END_BLOCK ditulis sebagai semua bit 1
+ */
+void POI::setPointer(char *data, Block value) {
+	if (pointerWidth == 2) {
+		unsigned short narrow = (unsigned short)value;
+		memcpy(data, (char*)&narrow, 2);
+	}
+	else {
+		memcpy(data, (char*)&value, 4);
+	}
+}
+
+/**
+ * Mengatur Allocation Table
+ * @param position pointer blok
+ * @param next     pointer blok berikutnya
+ */
+void POI::setNextBlock(Block position, Block next) {
+	MutexGuard guard(metaLock);
+	nextBlock[position] = next;
+	writeAllocationTable(position);
+}
+
+/**
+ * Mendapatkan satu blok kosong
+ * @param  hint blok yang diinginkan (biasanya setelah blok terakhir file)
+ * @return      blok yang dialokasikan
+ */
+Block POI::allocateBlock(Block hint) {
+	int length = 1;
+	return allocateRun(length, hint);
+}
+
+/**
+ * Mendapatkan sederet blok kosong yang berurutan, setiap blok
+ * ditandai END_BLOCK (belum dirangkai)
+ * @param  length jumlah blok yang diinginkan, diisi jumlah yang didapat
+ * @param  hint   blok awal yang diinginkan
+ * @return        blok pertama
+ */
+Block POI::allocateRun(int &length, Block hint) {
+	MutexGuard guard(metaLock);
+	Block result = allocator.allocateRun(length, hint);
+	if (result == END_BLOCK) {
+		throw runtime_error("Volume POI penuh");
+	}
+
+	for (int i = 0; i < length; i++) {
+		setNextBlock(result + i, END_BLOCK);
+	}
+
+	available -= length;
+	firstEmpty = allocator.first();
+	writeVolumeInformation();
+
+	return result;
+}
+
+/**
+ * Mendapatkan rantai baru sepanjang count blok, disusun dari
+ * deret blok berurutan sebisa mungkin
+ * @param  count jumlah blok
+ * @param  hint  blok awal yang diinginkan
+ * @return       blok pertama rantai
+ */
+Block POI::allocateChain(Block count, Block hint) {
+	Block first = END_BLOCK;
+	Block last = END_BLOCK;
+	while (count > 0) {
+		int length = min(count, (Block)INT_MAX);
+		Block start = allocateRun(length, hint);
+		if (last == END_BLOCK) {
+			first = start;
+		}
+		else {
+			setNextBlock(last, start);
+		}
+		for (int i = 0; i < length - 1; i++) {
+			setNextBlock(start + i, start + i + 1);
+		}
+		last = start + length - 1;
+		hint = last + 1;
+		count -= length;
+	}
+	return first;
+}
+
+
+/**
+ * Membebaskan blok
+ * @param position pointer yang dibebaskan
+ */
+void POI::freeBlock(Block position) {
+	MutexGuard guard(metaLock);
+	if (position == EMPTY_BLOCK || position == END_BLOCK) {
+		return;
+	}
+
+	/* cursor yang menunjuk rantai lama tidak valid lagi */
+	chainGeneration++;
+
+	while (position != END_BLOCK) {
+		Block temp = nextBlock[position];
+		setNextBlock(position, EMPTY_BLOCK);
+		releaseBlocks(position, 1);
+		position = temp;
+	}
+	firstEmpty = allocator.first();
+	writeVolumeInformation();
+}
+
+/**
+ * Mengembalikan blok ke allocator; dengan journal ditunda sampai
+ * transaksi yang membebaskannya sudah commit
+ * @param start  blok pertama
+ * @param length jumlah blok
+ */
+void POI::releaseBlocks(Block start, Block length) {
+	if (journal.active()) {
+		journal.release(start, length);
+	}
+	else {
+		allocator.releaseRun(start, length);
+		available += length;
+	}
+}
+
+/**
+ * Mendapatkan Entry dari path, memakai dentry cache untuk path penuh
+ * maupun untuk setiap komponen parent-nya
+ * @param  path path absolut
+ * @return      Entry kosong jika tidak ditemukan
+ */
+Entry POI::lookup(const char *path) {
+	string fullPath(path);
+	Entry entry;
+
+	if (dentry.get(fullPath, entry)) {
+		return entry;
+	}
+
+	/* pisahkan direktori parent dan nama */
+	size_t slash = fullPath.rfind('/');
+	string name = fullPath.substr(slash + 1);
+	Directory directory = Directory::root();
+	if (slash > 0) {
+		Entry owner = lookup(fullPath.substr(0, slash).c_str());
+		if (owner.isEmpty() || !(owner.getAttr() & 0x8)) {
+			dentry.putNegative(fullPath);
+			return Entry();
+		}
+		directory = Directory(owner);
+	}
+	Block parent = directory.index;
+
+	/* baca direktori hanya jika pasangan (parent, nama) belum di-cache */
+	if (!dentry.get(parent, name, entry)) {
+		entry = directory.find(name);
+	}
+
+	if (entry.isEmpty()) {
+		dentry.putNegative(fullPath);
+	}
+	else {
+		dentry.put(fullPath, parent, entry);
+	}
+	return entry;
+}
+
+/**
+ * Posisi byte sebuah blok data pool di file .poi
+ * @param  position
+ * @return
+ */
+off_t POI::blockOffset(Block position) {
+	/* data pool dimulai setelah header dan allocation table */
+	return (off_t)blockSize * (1 + fatBlocks) + (off_t)position * blockSize;
+}
+
+/**
+ * Membaca sebagian isi satu blok data pool, melalui cache blok
+ * @param position blok
+ * @param offset   offset dalam blok
+ * @param buffer
+ * @param size     tidak melewati batas blok
+ */
+void POI::readPool(Block position, int offset, char *buffer, int size) {
+	if (journal.read(position, offset, buffer, size)) {
+		return;
+	}
+	if (cache.enabled()) {
+		cache.read(position, buffer, size, offset);
+	}
+	else {
+		storage->read(blockOffset(position) + offset, buffer, size);
+	}
+}
+
+/**
+ * Menulis sebagian isi satu blok data pool, melalui cache blok
+ * @param position blok
+ * @param offset   offset dalam blok
+ * @param buffer
+ * @param size     tidak melewati batas blok
+ */
+void POI::writePool(Block position, int offset, const char *buffer, int size) {
+	if (cache.enabled()) {
+		cache.write(position, buffer, size, offset);
+	}
+	else {
+		storage->write(blockOffset(position) + offset, buffer, size);
+	}
+}
+
+/**
+ * Membaca potongan beberapa blok sekaligus: melalui cache (blok yang
+ * belum ada dimuat dalam satu batch) atau langsung dari volume dengan
+ * potongan yang bersebelahan digabung
+ * @param requests potongan blok, masing-masing tidak melewati batas blok
+ */
+void POI::readPools(vector<PoolRequest> &requests) {
+	if (journal.active()) {
+		/* blok metadata yang menunggu commit dibaca dari journal */
+		vector<PoolRequest> rest;
+		for (size_t i = 0; i < requests.size(); i++) {
+			PoolRequest &request = requests[i];
+			if (!journal.read(request.position, request.offset, request.buffer, request.size)) {
+				rest.push_back(request);
+			}
+		}
+		requests.swap(rest);
+	}
+
+	if (cache.enabled()) {
+		cache.read(requests);
+		return;
+	}
+	vector<IORequest> batch;
+	poolBatch(requests, batch);
+	storage->readBatch(batch);
+}
+
+/**
+ * Menulis potongan beberapa blok sekaligus, melalui cache atau
+ * langsung ke volume dalam satu batch
+ * @param requests potongan blok, masing-masing tidak melewati batas blok
+ */
+void POI::writePools(vector<PoolRequest> &requests) {
+	if (cache.enabled()) {
+		for (size_t i = 0; i < requests.size(); i++) {
+			cache.write(requests[i].position, requests[i].buffer, requests[i].size, requests[i].offset);
+		}
+		return;
+	}
+	vector<IORequest> batch;
+	poolBatch(requests, batch);
+	storage->writeBatch(batch);
+}
+
+/**
+ * Mengubah potongan blok menjadi permintaan ke file .poi, potongan yang
+ * bersebelahan di volume dan di buffer menjadi satu permintaan
+ * @param requests potongan blok
+ * @param batch    hasil
+ */
+void POI::poolBatch(const vector<PoolRequest> &requests, vector<IORequest> &batch) {
+	for (size_t i = 0; i < requests.size(); i++) {
+		off_t position = blockOffset(requests[i].position) + requests[i].offset;
+		if (!batch.empty()) {
+			IORequest &last = batch.back();
+			if (last.position + (off_t)last.size == position && last.buffer + last.size == requests[i].buffer) {
+				last.size += requests[i].size;
+				continue;
+			}
+		}
+		IORequest request = {position, requests[i].buffer, (size_t)requests[i].size};
+		batch.push_back(request);
+	}
+}
+
+/**
+ * Menulis sebagian isi blok metadata data pool (entry, direktori,
+ * extent overflow); dengan journal ditahan sampai commit
+ * @param position blok
+ * @param offset   offset dalam blok
+ * @param buffer
+ * @param size     tidak melewati batas blok
+ */
+void POI::writeMetadata(Block position, int offset, const char *buffer, int size) {
+	MutexGuard guard(metaLock);
+	if (journal.active()) {
+		journal.put(position, offset, buffer, size);
+	}
+	else {
+		writePool(position, offset, buffer, size);
+	}
+}
+
+/**
+ * Pointer langsung ke isi blok jika backend memetakan volume
+ * dan tidak ada cache maupun journal di antaranya
+ * @param  position blok
+ * @return          NULL jika blok harus dibaca
+ */
+const char *POI::blockPointer(Block position) {
+	if (cache.enabled() || journal.active()) {
+		return NULL;
+	}
+	return storage->pointer(blockOffset(position));
+}
+
+/**
+ * Mencari blok pada rantai yang memuat byte ke-offset,
+ * dimulai dari cursor jika cursor masih valid dan tidak melewati offset
+ * @param  first    blok pertama rantai
+ * @param  offset   offset byte dari awal rantai
+ * @param  cursor   posisi terakhir, diperbarui ke blok hasil
+ * @param  allocate alokasikan blok jika rantai kurang panjang
+ * @param  end      offset byte terakhir yang akan ditulis, rantai
+ *                  diperpanjang sampai end sekaligus
+ * @return          END_BLOCK jika rantai kurang panjang
+ */
+Block POI::seekBlock(Block first, off_t offset, ChainCursor &cursor, bool allocate, off_t end) {
+	if (cursor.first != first || cursor.generation != chainGeneration || cursor.offset > offset) {
+		cursor.first = first;
+		cursor.offset = 0;
+		cursor.position = first;
+		cursor.generation = chainGeneration;
+	}
+
+	while (offset - cursor.offset >= blockSize) {
+		/* kalau nextBlock tidak ada, alokasikan */
+		if (nextBlock[cursor.position] == END_BLOCK) {
+			if (!allocate) {
+				return END_BLOCK;
+			}
+			Block count = (max(offset, end) - cursor.offset) / blockSize;
+			setNextBlock(cursor.position, allocateChain(count, cursor.position + 1));
+		}
+		cursor.position = nextBlock[cursor.position];
+		cursor.offset += blockSize;
+	}
+	return cursor.position;
+}
+
+/**
+ * Membaca isi block sebesar size kemudian menaruh hasilnya di buf
+ * @param  position blok pertama rantai
+ * @param  buffer
+ * @param  size
+ * @param  offset   offset byte dari awal rantai
+ * @param  cursor   posisi terakhir pada rantai, boleh NULL
+ * @return          jumlah byte yang terbaca
+ */
+int POI::readBlock(Block position, char *buffer, int size, off_t offset, ChainCursor *cursor) {
+	ChainCursor local;
+	if (cursor == NULL) {
+		cursor = &local;
+	}
+
+	/* kumpulkan potongan per blok, lalu dibaca dalam satu batch */
+	vector<PoolRequest> requests;
+	int done = 0;
+	Block block = seekBlock(position, offset, *cursor, false);
+	while (done < size && block != END_BLOCK) {
+		/* cuma bisa baca sampai batas blok */
+		int offset_now = offset + done - cursor->offset;
+		int size_now = min(size - done, blockSize - offset_now);
+		PoolRequest request = {block, offset_now, buffer + done, size_now};
+		requests.push_back(request);
+		done += size_now;
+
+		/* lanjutkan di nextBlock */
+		if (done < size) {
+			block = seekBlock(position, offset + done, *cursor, false);
+		}
+	}
+	readPools(requests);
+	return done;
+}
+
+/**
+ * Menuliskan isi buffer ke filesystem, blok dialokasikan jika perlu
+ * @param  position blok pertama rantai
+ * @param  buffer
+ * @param  size
+ * @param  offset   offset byte dari awal rantai
+ * @param  cursor   posisi terakhir pada rantai, boleh NULL
+ * @return          jumlah byte yang tertulis
+ */
+int POI::writeBlock(Block position, const char *buffer, int size, off_t offset, ChainCursor *cursor) {
+	ChainCursor local;
+	if (cursor == NULL) {
+		cursor = &local;
+	}
+
+	vector<PoolRequest> requests;
+	int done = 0;
+	while (done < size) {
+		Block block = seekBlock(position, offset + done, *cursor, true, offset + size - 1);
+		int offset_now = offset + done - cursor->offset;
+		int size_now = min(size - done, blockSize - offset_now);
+		PoolRequest request = {block, offset_now, (char*)buffer + done, size_now};
+		requests.push_back(request);
+		done += size_now;
+	}
+	writePools(requests);
+	return done;
+}
+
+/**
+ * Menyiapkan entry file baru yang masih kosong; file v1 langsung
+ * mendapat blok pertama, file v2 belum memiliki extent
+ * @param entry entry file
+ */
+void POI::initFile(Entry &entry) {
+	if (version == VOLUME_VERSION_EXTENT) {
+		memset(entry.data + entryBase, 0, EXTENT_INLINE_COUNT * 2 * pointerWidth);
+		entry.setIndex(END_BLOCK);
+
+		/* file baru disimpan inline sampai melewati inlineCapacity */
+		if (inlineCapacity > 0) {
+			memset(entry.data + inlineOffset, 0, entrySize - inlineOffset);
+			entry.setAttr(entry.getAttr() | ATTR_INLINE);
+		}
+	}
+	else {
+		entry.setIndex(allocateBlock());
+	}
+}
+
+/**
+ * Apakah isi file disimpan di dalam entry
+ * @param  entry entry file
+ * @return
+ */
+bool POI::isInline(Entry &entry) {
+	return (entry.getAttr() & ATTR_INLINE) != 0;
+}
+
+/**
+ * Memindahkan isi inline ke blok data pool saat file tumbuh melewati
+ * inlineCapacity; isi inline selalu muat dalam satu blok. Lock handle
+ * sudah dipegang.
+ * @param handle handle file
+ */
+void POI::expandInline(FileHandle &handle) {
+	Entry &entry = handle.entry;
+	int size = entry.getSize();
+	vector<char> content(entry.data + inlineOffset, entry.data + inlineOffset + size);
+
+	memset(entry.data + inlineOffset, 0, entrySize - inlineOffset);
+	entry.setAttr(entry.getAttr() & ~ATTR_INLINE);
+	entry.setIndex(END_BLOCK);
+
+	ExtentList &extents = handle.extents;
+	extents.load(entry);
+	if (size > 0) {
+		/* sisa blok dinolkan, blok baru bisa berisi data lama */
+		content.resize(blockSize, 0);
+		allocateExtents(extents, size);
+		writePool(extents.map(0), 0, &content[0], blockSize);
+	}
+	extents.store(entry);
+	extents.generation = ++extentGeneration;
+	entry.write();
+}
+
+/**
+ * Membaca isi file, size sudah dibatasi ukuran file oleh pemanggil
+ * @param  handle handle file
+ * @param  buffer
+ * @param  size
+ * @param  offset offset byte dari awal file
+ * @return        jumlah byte yang terbaca
+ */
+int POI::readFile(FileHandle &handle, char *buffer, int size, off_t offset) {
+	MutexGuard guard(handle.lock);
+	if (version != VOLUME_VERSION_EXTENT) {
+		int done = readBlock(handle.entry.getIndex(), buffer, size, offset, &handle.cursor);
+		readahead(handle, offset, done);
+		return done;
+	}
+
+	/* isi inline sudah ada di entry, tanpa I/O */
+	if (isInline(handle.entry)) {
+		memcpy(buffer, handle.entry.data + inlineOffset + offset, size);
+		return size;
+	}
+
+	ExtentList &extents = handle.extents;
+	if (!extents.loaded || extents.generation != extentGeneration) {
+		extents.load(handle.entry);
+	}
+
+	vector<PoolRequest> requests;
+	int done = 0;
+	while (done < size) {
+		Block block = extents.map((offset + done) / blockSize);
+		int offset_now = (offset + done) % blockSize;
+		int size_now = min(size - done, blockSize - offset_now);
+
+		/* bagian file yang diperbesar dengan truncate belum memiliki blok */
+		if (block == END_BLOCK) {
+			memset(buffer + done, 0, size - done);
+			done = size;
+			break;
+		}
+		PoolRequest request = {block, offset_now, buffer + done, size_now};
+		requests.push_back(request);
+		done += size_now;
+	}
+	readPools(requests);
+	readahead(handle, offset, done);
+	return done;
+}
+
+/**
+ * Mencatat pola baca dan mem-prefetch blok berikutnya jika baca
+ * berurutan. Prefetch dilakukan saat sisa jendela tinggal setengah;
+ * jendela berlipat dua setiap kali, sampai readaheadMax.
+ * @param handle handle file, lock handle sudah dipegang
+ * @param offset offset baca
+ * @param size   jumlah byte yang terbaca
+ */
+void POI::readahead(FileHandle &handle, off_t offset, int size) {
+	Readahead &state = handle.readahead;
+	bool sequential = offset == state.next;
+	state.next = offset + size;
+
+	/* baca acak atau tanpa cache: jendela ditutup */
+	Block limit = min((size_t)(readaheadMax / blockSize), cache.capacity() / 4);
+	if (!sequential || limit == 0 || size == 0) {
+		state.window = 0;
+		state.ahead = 0;
+		return;
+	}
+
+	Block end = (offset + size + blockSize - 1) / blockSize;
+	state.ahead = max(state.ahead, end);
+	if (state.window == 0) {
+		state.window = min(max(READAHEAD_MIN / blockSize, 1), (int)limit);
+	}
+	else if (state.ahead - end > state.window / 2) {
+		return;
+	}
+	else {
+		state.window = min(state.window * 2, limit);
+	}
+
+	Block fileBlocks = (handle.entry.getSize() + blockSize - 1) / blockSize;
+	Block last = min(end + state.window, fileBlocks);
+	if (last > state.ahead) {
+		prefetchFile(handle, state.ahead, last - state.ahead);
+		state.ahead = last;
+	}
+}
+
+/**
+ * Mem-prefetch blok logis [first, first + count) sebuah file ke cache,
+ * setiap deret blok berurutan di volume menjadi satu pembacaan dan
+ * semua deret dikirim dalam satu batch
+ * @param handle handle file
+ * @param first  blok logis pertama
+ * @param count  jumlah blok
+ */
+void POI::prefetchFile(FileHandle &handle, Block first, Block count) {
+	vector<Extent> runs;
+	Block block = END_BLOCK;
+	for (Block i = 0; i < count; i++) {
+		if (version == VOLUME_VERSION_EXTENT) {
+			block = handle.extents.map(first + i);
+		}
+		else if (i == 0) {
+			/* cursor sendiri, cursor baca tidak boleh melewati offset baca */
+			block = seekBlock(handle.entry.getIndex(), (off_t)first * blockSize, handle.readahead.cursor, false);
+		}
+		else {
+			block = nextBlock[block];
+		}
+		if (block == END_BLOCK) {
+			break;
+		}
+
+		if (!runs.empty() && block == runs.back().start + runs.back().length) {
+			runs.back().length++;
+			continue;
+		}
+		Extent run = {block, 1};
+		runs.push_back(run);
+	}
+	cache.prefetch(runs);
+}
+
+/**
+ * Menulis isi file, blok dialokasikan jika perlu dan ukuran file
+ * diperbarui jika menulis melewati akhir file
+ * @param  handle handle file
+ * @param  buffer
+ * @param  size
+ * @param  offset offset byte dari awal file
+ * @return        jumlah byte yang tertulis
+ */
+int POI::writeFile(FileHandle &handle, const char *buffer, int size, off_t offset) {
+	MutexGuard guard(handle.lock);
+	Entry &entry = handle.entry;
+	bool changed = false;
+	int done;
+
+	if (version != VOLUME_VERSION_EXTENT) {
+		done = writeBlock(entry.getIndex(), buffer, size, offset, &handle.cursor);
+	}
+	else if (isInline(entry) && offset + size <= inlineCapacity) {
+		/* bagian setelah akhir file selalu nol, lubang terbaca nol */
+		memcpy(entry.data + inlineOffset + offset, buffer, size);
+		done = size;
+		changed = true;
+	}
+	else {
+		if (isInline(entry)) {
+			expandInline(handle);
+		}
+		ExtentList &extents = handle.extents;
+		if (!extents.loaded || extents.generation != extentGeneration) {
+			extents.load(entry);
+		}
+
+		changed = allocateWrite(extents, offset, size);
+		changed = unshareExtents(extents, offset, size) || changed;
+
+		vector<PoolRequest> requests;
+		done = 0;
+		while (done < size) {
+			Block block = extents.map((offset + done) / blockSize);
+			int offset_now = (offset + done) % blockSize;
+			int size_now = min(size - done, blockSize - offset_now);
+			PoolRequest request = {block, offset_now, (char*)buffer + done, size_now};
+			requests.push_back(request);
+			done += size_now;
+		}
+		writePools(requests);
+
+		if (changed) {
+			extents.store(entry);
+			extents.generation = ++extentGeneration;
+		}
+	}
+
+	finishWrite(entry, offset + done, changed);
+	return done;
 }
 
 /**
- * Inisialisasi Allocation Table
+ * Menyimpan entry setelah isi file ditulis, ukuran hanya bertambah
+ * jika menulis melewati akhir file
+ * @param entry   entry file
+ * @param end     offset byte akhir penulisan
+ * @param changed entry sudah berubah (extent baru)
  */
-void POI::initAllocationTable() {
-	/* root ada */
-	short buffer = 0xFFFF;
-	file.write((char*)&buffer, 2);
-
-	/* lainnya belum ada */
-	buffer = 0;
-	for (int i = 1; i < N_BLOCK; i++) {
-		file.write((char*)&buffer, 2);
+void POI::finishWrite(Entry &entry, off_t end, bool changed) {
+	if (end > entry.getSize()) {
+		entry.setSize(end);
+		changed = true;
+	}
+	if (changed) {
+		entry.write();
 	}
 }
 
 /**
- * Inisialisasi Data Pool
+ * Mengalokasikan blok sampai byte end, berurutan setelah extent terakhir
+ * @param  extents extent file
+ * @param  end     offset byte akhir yang harus memiliki blok
+ * @return         true jika extent bertambah
  */
-void POI::initDataPool() {
-	/* Semua blok dikosongkan */
-	char buffer[BLOCK_SIZE];
-	memset(buffer, 0, BLOCK_SIZE);
-	for (int i = 0; i < N_BLOCK; i++) {
-		file.write(buffer, BLOCK_SIZE);
+bool POI::allocateExtents(ExtentList &extents, off_t end) {
+	bool changed = false;
+	off_t needed = end > 0 ? (end - 1) / blockSize + 1 - (off_t)extents.blocks() : 0;
+	while (needed > 0) {
+		Block hint = END_BLOCK;
+		if (!extents.extents.empty()) {
+			hint = extents.extents.back().start + extents.extents.back().length;
+		}
+		int length = min(needed, (off_t)INT_MAX);
+		Block start = allocateRun(length, hint);
+		for (int i = 0; i < length; i++) {
+			extents.append(start + i);
+		}
+		needed -= length;
+		changed = true;
 	}
+	return changed;
 }
 
 /**
- * Baca file poi
- * @param filename nama file
+ * Mengalokasikan blok sampai akhir penulisan [offset, offset + size).
+ * Blok baru yang tidak seluruhnya ditimpa penulisan (lubang sebelum
+ * offset, blok awal dan akhir yang terisi sebagian) dinolkan, karena
+ * bisa berisi data file yang sudah dihapus.
+ * @param  extents extent file
+ * @param  offset  offset byte awal penulisan
+ * @param  size    jumlah byte yang ditulis
+ * @return         true jika extent bertambah
  */
-void POI::load(const char *filename){
-	/* buka file dengan mode input-output, dan binary */
-	file.open(filename, fstream::in | fstream::out | fstream::binary);
-
-	/* cek apakah file ada */
-	if (!file.is_open()){
-		file.close();
-		throw runtime_error("File tidak ditemukan");
+bool POI::allocateWrite(ExtentList &extents, off_t offset, off_t size) {
+	Block have = extents.blocks();
+	if (!allocateExtents(extents, offset + size)) {
+		return false;
 	}
 
-	/* periksa Volume Information */
-	readVolumeInformation();
-
-	/* baca Allocation Table */
-	readAllocationTable();
+	/* blok [covered, end) seluruhnya ditimpa penulisan */
+	Block needed = extents.blocks();
+	Block covered = (offset + blockSize - 1) / blockSize;
+	Block end = (offset + size) / blockSize;
+	for (Block block = have; block < needed;) {
+		if (block >= covered && block < end) {
+			block = end;
+			continue;
+		}
+		Block start = extents.map(block);
+		Block count = 1;
+		while (block + count < needed && !(block + count >= covered && block + count < end)
+			&& extents.map(block + count) == start + count) {
+			count++;
+		}
+		zeroBlocks(start, count);
+		block += count;
+	}
+	return true;
 }
 
 /**
- * Membaca Volume Information
+ * Memetakan rentang byte file ke potongan berurutan di file .poi agar
+ * isi file bisa dibaca/ditulis langsung lewat descriptor volume.
+ * Blok berdekatan digabung dalam satu potongan. Blok yang ada di cache
+ * ditulis dulu, dan dibuang jika rentang akan ditimpa. File inline
+ * dipindahkan ke blok jika write; isi inline dibaca lewat readFile.
+ * @param handle   handle file
+ * @param size     jumlah byte
+ * @param offset   offset byte dari awal file
+ * @param write    alokasikan blok yang belum ada, ukuran file diperbarui
+ *                 oleh finishWrite setelah isi ditulis
+ * @param segments hasil, position -1 untuk bagian file tanpa blok
  */
-void POI::readVolumeInformation() {
-	char buffer[BLOCK_SIZE];
-	file.seekg(0);
-
-	/* Baca keseluruhan Volume Information */
-	file.read(buffer, BLOCK_SIZE);
-
-	/* cek magic string */
-	if (string(buffer, 4) != "poi!") {
-		file.close();
-		throw runtime_error("File bukan file POI yang valid");
+void POI::mapFile(FileHandle &handle, size_t size, off_t offset, bool write, vector<Segment> &segments) {
+	MutexGuard guard(handle.lock);
+	Entry &entry = handle.entry;
+	ExtentList &extents = handle.extents;
+	segments.clear();
+
+	if (version == VOLUME_VERSION_EXTENT) {
+		if (write && isInline(entry)) {
+			expandInline(handle);
+		}
+		if (!extents.loaded || extents.generation != extentGeneration) {
+			extents.load(entry);
+		}
+		if (write) {
+			bool changed = allocateWrite(extents, offset, size);
+			changed = unshareExtents(extents, offset, size) || changed;
+			if (changed) {
+				extents.store(entry);
+				extents.generation = ++extentGeneration;
+				entry.write();
+			}
+		}
 	}
 
-	/* baca capacity */
-	memcpy((char*)&capacity, buffer + 0x24, 4);
-
-	/* baca available */
-	memcpy((char*)&available, buffer + 0x28, 4);
-
-	/* baca firstEmpty */
-	memcpy((char*)&firstEmpty, buffer + 0x2C, 4);
-}
-
-/**
- * Membaca Allocation Table
- */
-void POI::readAllocationTable() {
-	char buffer[3];
+	size_t done = 0;
+	while (done < size) {
+		Block block;
+		int offset_now;
+		if (version == VOLUME_VERSION_EXTENT) {
+			block = extents.map((offset + done) / blockSize);
+			offset_now = (offset + done) % blockSize;
+		}
+		else {
+			block = seekBlock(entry.getIndex(), offset + done, handle.cursor, write, offset + size - 1);
+			if (block == END_BLOCK) {
+				break;
+			}
+			offset_now = offset + done - handle.cursor.offset;
+		}
+		size_t size_now = min(size - done, (size_t)(blockSize - offset_now));
 
-	/* pindah posisi ke awal Allocation Table */
-	file.seekg(0x200);
+		off_t position = -1;
+		if (block != END_BLOCK) {
+			cache.sync(block, write);
+			position = blockOffset(block) + offset_now;
+		}
 
-	/* baca nilai nextBlock */
-	for (int i = 0; i < N_BLOCK; i++) {
-		file.read(buffer, 2);
-		memcpy((char*)&nextBlock[i], buffer, 2);
+		/* gabungkan dengan potongan sebelumnya jika bersambung */
+		Segment *last = segments.empty() ? NULL : &segments.back();
+		if (last != NULL && (position == -1 ? last->position == -1 : last->position != -1 && last->position + (off_t)last->size == position)) {
+			last->size += size_now;
+		}
+		else {
+			Segment segment;
+			segment.position = position;
+			segment.size = size_now;
+			segments.push_back(segment);
+		}
+		done += size_now;
 	}
 }
 
 /**
- * Menuliskan Volume Information
+ * Mengubah ukuran file, blok yang tidak terpakai dibebaskan
+ * @param handle handle file
+ * @param size   ukuran baru
  */
-void POI::writeVolumeInformation() {
-	file.seekp(0x00);
-
-	/* buffer untuk menulis ke file */
-	char buffer[BLOCK_SIZE];
-	memset(buffer, 0, BLOCK_SIZE);
+void POI::truncateFile(FileHandle &handle, off_t size) {
+	MutexGuard guard(handle.lock);
+	Entry &entry = handle.entry;
+
+	if (version == VOLUME_VERSION_EXTENT) {
+		/* isi inline: bagian yang dipotong dinolkan, lubang terbaca nol */
+		if (isInline(entry) && size <= inlineCapacity) {
+			off_t oldSize = entry.getSize();
+			if (size < oldSize) {
+				memset(entry.data + inlineOffset + size, 0, oldSize - size);
+			}
+			entry.setSize(size);
+			entry.write();
+			return;
+		}
+		if (isInline(entry)) {
+			expandInline(handle);
+		}
 
-	/* Magic string "POI" */
-	memcpy(buffer + 0x00, "poi!", 4);
+		ExtentList &extents = handle.extents;
+		if (!extents.loaded || extents.generation != extentGeneration) {
+			extents.load(entry);
+		}
+		extents.truncate((size + blockSize - 1) / blockSize);
+
+		/* sisa blok terakhir setelah ukuran baru dinolkan, agar terbaca
+		   nol jika file diperpanjang lagi */
+		int tail = size % blockSize;
+		if (size < entry.getSize() && tail != 0 && extents.map(size / blockSize) != END_BLOCK) {
+			unshareExtents(extents, size, blockSize - tail);
+			vector<char> zeros(blockSize - tail, 0);
+			writePool(extents.map(size / blockSize), tail, &zeros[0], zeros.size());
+		}
+		extents.store(entry);
+		extents.generation = ++extentGeneration;
 
-	/* Nama volume */
-	memcpy(buffer + 0x04, filename.c_str(), filename.length());
+		/* file yang dikosongkan kembali inline, seperti file baru */
+		if (size == 0 && inlineCapacity > 0) {
+			initFile(entry);
+			extents.load(entry);
+		}
+		entry.setSize(size);
+		entry.write();
+		return;
+	}
 
-	/* Kapasitas filesystem, dalam little endian */
-	memcpy(buffer + 0x24, (char*)&capacity, 4);
+	entry.setSize(size);
 
-	/* Jumlah blok yang belum terpakai, dalam little endian */
-	memcpy(buffer + 0x28, (char*)&available, 4);
+	entry.write();
 
-	/* Indeks blok pertama yang bebas, dalam little endian */
-	memcpy(buffer + 0x2C, (char*)&firstEmpty, 4);
+	// menangani allocation table
+	Block blocks = max((off_t)1, (size + blockSize - 1) / blockSize);
+	Block position = entry.getIndex();
+	for (Block i = 1; i < blocks; i++) {
+		// kasus butuh alokasi baru, sisa rantai dialokasikan sekaligus
+		if (nextBlock[position] == END_BLOCK)
+			setNextBlock(position, allocateChain(blocks - i, position + 1));
 
-	/* String "!iop" */
-	memcpy(buffer + 0x1FC, "!iop", 4);
+		position = nextBlock[position];
+	}
 
-	file.write(buffer, BLOCK_SIZE);
+	if (nextBlock[position] != END_BLOCK) {
+		freeBlock(nextBlock[position]);
+		setNextBlock(position, END_BLOCK);
+	}
 }
 
 /**
- * Menuliskan Allocation Table pada posisi tertentu
- * @param position posisi pointer blok
+ * Mengisi nol sederet blok data pool, frame cache blok tersebut dibuang
+ * @param start  blok pertama
+ * @param length jumlah blok
  */
-void POI::writeAllocationTable(Block position) {
-	file.seekp(BLOCK_SIZE + sizeof(Block) * position);
-	file.write((char*)&nextBlock[position], sizeof(Block));
+void POI::zeroBlocks(Block start, Block length) {
+	for (Block i = 0; i < length; i++) {
+		cache.sync(start + i, true);
+	}
+	storage->zero(blockOffset(start), (off_t)length * blockSize);
 }
 
 /**
- * Mengatur Allocation Table
- * @param position pointer blok
- * @param next     pointer blok berikutnya
+ * Memesan blok untuk rentang file (fallocate). Blok baru dialokasikan
+ * sekaligus sebagai deret berurutan dalam satu perubahan metadata lalu
+ * dinolkan, sehingga penulisan berikutnya hanya menyentuh blok data.
+ * @param  handle   file
+ * @param  offset   offset byte awal
+ * @param  length   panjang rentang
+ * @param  keepSize ukuran file tidak berubah (FALLOC_FL_KEEP_SIZE)
+ * @return          false jika blok kosong tidak cukup
  */
-void POI::setNextBlock(Block position, Block next) {
-	nextBlock[position] = next;
-	writeAllocationTable(position);
+bool POI::preallocateFile(FileHandle &handle, off_t offset, off_t length, bool keepSize) {
+	Entry &entry = handle.entry;
+	off_t end = offset + length;
+	off_t size = entry.getSize();
+	Block needed = (end + blockSize - 1) / blockSize;
+
+	/* sisa blok terakhir setelah akhir file bisa berisi data lama */
+	if (!keepSize && end > size && size % blockSize != 0 && !isInline(entry)) {
+		vector<char> zeros(min(end, (size / blockSize + 1) * blockSize) - size, 0);
+		writeFile(handle, &zeros[0], zeros.size(), size);
+	}
+
+	MutexGuard guard(handle.lock);
+	bool changed = false;
+
+	if (version == VOLUME_VERSION_EXTENT) {
+		ExtentList &extents = handle.extents;
+		if (!isInline(entry) && (!extents.loaded || extents.generation != extentGeneration)) {
+			extents.load(entry);
+		}
+		Block have = isInline(entry) ? 0 : extents.blocks();
+		if (isInline(entry) && end <= inlineCapacity) {
+			/* tempat sudah ada di entry */
+		}
+		else if (needed > have) {
+			if (needed - have > available) {
+				return false;
+			}
+			if (isInline(entry)) {
+				expandInline(handle);
+				have = extents.blocks();
+			}
+			allocateExtents(extents, end);
+
+			/* blok baru mungkin berisi data file yang sudah dihapus */
+			for (Block block = have; block < needed;) {
+				Block start = extents.map(block);
+				Block count = 1;
+				while (block + count < needed && extents.map(block + count) == start + count) {
+					count++;
+				}
+				zeroBlocks(start, count);
+				block += count;
+			}
+			extents.store(entry);
+			extents.generation = ++extentGeneration;
+			changed = true;
+		}
+	}
+	else {
+		Block last = entry.getIndex();
+		Block have = 1;
+		while (nextBlock[last] != END_BLOCK) {
+			last = nextBlock[last];
+			have++;
+		}
+		if (needed > have) {
+			if (needed - have > available) {
+				return false;
+			}
+			Block first = allocateChain(needed - have, last + 1);
+			setNextBlock(last, first);
+			for (Block block = first; block != END_BLOCK;) {
+				Block count = 1;
+				while (nextBlock[block + count - 1] == block + count) {
+					count++;
+				}
+				zeroBlocks(block, count);
+				block = nextBlock[block + count - 1];
+			}
+		}
+	}
+
+	if (keepSize) {
+		end = size;
+	}
+	finishWrite(entry, end, changed);
+	return true;
 }
 
 /**
- * Mendapatkan blok kosong yang berikutnya
- * @return pointer ke blok kosong pertama
+ * Mengosongkan rentang file (FALLOC_FL_PUNCH_HOLE, ukuran tetap). Rantai
+ * dan extent tidak bisa berlubang, jadi rentang di dalam file dinolkan;
+ * blok pesanan setelah akhir file yang seluruhnya terkena dibebaskan.
+ * @param handle file
+ * @param offset offset byte awal
+ * @param length panjang rentang
  */
-Block POI::allocateBlock() {
-	Block result = firstEmpty;
+void POI::punchFile(FileHandle &handle, off_t offset, off_t length) {
+	Entry &entry = handle.entry;
+	off_t size = entry.getSize();
+	off_t end = min(offset + length, size);
+
+	/* blok yang hanya sebagian terkena ditulis nol biasa */
+	off_t first = (offset + blockSize - 1) / blockSize;
+	off_t last = end / blockSize;
+	vector<pair<off_t, off_t> > partial;
+	if (isInline(entry) || first >= last) {
+		first = last = 0;
+		partial.push_back(make_pair(offset, end));
+	}
+	else {
+		partial.push_back(make_pair(offset, first * blockSize));
+		partial.push_back(make_pair(last * blockSize, end));
+	}
 
-	setNextBlock(result, END_BLOCK);
+	/* per blok; blok v2 yang belum dialokasikan sudah terbaca nol, dilewati
+	   agar lubang sebelumnya tidak ikut dialokasikan oleh writeFile */
+	vector<char> zeros(blockSize, 0);
+	for (size_t i = 0; i < partial.size(); i++) {
+		for (off_t position = partial[i].first; position < partial[i].second;) {
+			off_t next = min(partial[i].second, (position / blockSize + 1) * blockSize);
+			bool mapped = true;
+			if (version == VOLUME_VERSION_EXTENT && !isInline(entry)) {
+				MutexGuard guard(handle.lock);
+				ExtentList &extents = handle.extents;
+				if (!extents.loaded || extents.generation != extentGeneration) {
+					extents.load(entry);
+				}
+				mapped = extents.map(position / blockSize) != END_BLOCK;
+			}
+			if (mapped) {
+				writeFile(handle, &zeros[0], next - position, position);
+			}
+			position = next;
+		}
+	}
 
-	while (nextBlock[firstEmpty] != 0x0000) {
-		firstEmpty++;
+	MutexGuard guard(handle.lock);
+	if (isInline(entry)) {
+		return;
 	}
+	off_t keep = max((size + blockSize - 1) / blockSize, (offset + blockSize - 1) / blockSize);
 
-	available--;
-	writeVolumeInformation();
+	if (version == VOLUME_VERSION_EXTENT) {
+		ExtentList &extents = handle.extents;
+		if (!extents.loaded || extents.generation != extentGeneration) {
+			extents.load(entry);
+		}
 
-	return result;
-}
+		/* blok bersama diganti milik file ini dulu, isinya tidak disalin */
+		bool changed = unshareExtents(extents, first * blockSize, (last - first) * blockSize);
+		last = min(last, (off_t)extents.blocks());
+		for (off_t block = first; block < last;) {
+			Block start = extents.map(block);
+			Block count = 1;
+			while (block + count < last && extents.map(block + count) == start + count) {
+				count++;
+			}
+			zeroBlocks(start, count);
+			block += count;
+		}
+
+		if ((off_t)extents.blocks() * blockSize <= offset + length && (off_t)extents.blocks() > keep) {
+			extents.truncate(keep);
+			changed = true;
+		}
+		if (changed) {
+			extents.store(entry);
+			extents.generation = ++extentGeneration;
+			entry.write();
+		}
+		return;
+	}
+
+	ChainCursor cursor;
+	for (off_t block = first; block < last;) {
+		Block start = seekBlock(entry.getIndex(), block * blockSize, cursor, false);
+		if (start == END_BLOCK) {
+			break;
+		}
+		Block count = 1;
+		while (block + count < last && nextBlock[start + count - 1] == start + count) {
+			count++;
+		}
+		zeroBlocks(start, count);
+		block += count;
+	}
 
+	/* rantai v1 selalu memiliki blok pertama */
+	keep = max(keep, (off_t)1);
+	Block position = entry.getIndex();
+	off_t blocks = 1;
+	while (nextBlock[position] != END_BLOCK) {
+		position = nextBlock[position];
+		blocks++;
+	}
+	if (blocks * blockSize <= offset + length && blocks > keep) {
+		position = seekBlock(entry.getIndex(), (keep - 1) * blockSize, cursor, false);
+		freeBlock(nextBlock[position]);
+		setNextBlock(position, END_BLOCK);
+	}
+}
 
 /**
- * Membebaskan blok
- * @param position pointer yang dibebaskan
+ * Membebaskan semua blok isi file
+ * @param entry entry file
  */
-void POI::freeBlock(Block position) {
-	if (position == EMPTY_BLOCK) {
+void POI::releaseFile(const Entry &entry) {
+	Entry temp = entry;
+	if (isInline(temp)) {
 		return;
 	}
-	while (position != END_BLOCK) {
-		Block temp = nextBlock[position];
-		setNextBlock(position, EMPTY_BLOCK);
-		position = temp;
-		available--;
+	if (version == VOLUME_VERSION_EXTENT) {
+		/* rantai overflow ikut dibebaskan oleh store */
+		ExtentList extents;
+		extents.load(temp);
+		extents.truncate(0);
+		extents.store(temp);
+		extentGeneration++;
 	}
+	else {
+		freeBlock(temp.getIndex());
+	}
+}
+
+/**
+ * Membebaskan sederet blok berurutan yang tidak membentuk rantai
+ * @param start  blok pertama
+ * @param length jumlah blok
+ */
+void POI::freeRange(Block start, Block length) {
+	MutexGuard guard(metaLock);
+
+	/* blok yang masih dirujuk file lain hanya berkurang referensinya */
+	Block run = 0;
+	for (Block i = 0; i < length; i++) {
+		Block refs = sharedBlocks > 0 ? refCount(start + i) : 1;
+		if (refs > 1) {
+			setNextBlock(start + i, refs == 2 ? END_BLOCK : pointerLimit() - (refs - 2));
+			if (refs == 2) {
+				sharedBlocks--;
+			}
+			if (run > 0) {
+				releaseBlocks(start + i - run, run);
+				run = 0;
+			}
+			continue;
+		}
+		setNextBlock(start + i, EMPTY_BLOCK);
+		run++;
+	}
+	if (run > 0) {
+		releaseBlocks(start + length - run, run);
+	}
+	firstEmpty = allocator.first();
+	chainGeneration++;
 	writeVolumeInformation();
 }
 
 /**
- * Membaca isi block sebesar size kemudian menaruh hasilnya di buf
- * @param  position
- * @param  buffer
- * @param  size
- * @param  offset
- * @return
+ * Nilai pointer terbesar di volume. Blok data v2 yang dirujuk r > 1 file
+ * bernilai pointerLimit - (r - 1) di allocation table, di atas kapasitas
+ * sehingga tidak tertukar dengan pointer rantai maupun END_BLOCK.
  */
-int POI::readBlock(Block position, char *buffer, int size, int offset) {
-	/* kalau sudah di END_BLOCK, return */
-	if (position == END_BLOCK) {
+Block POI::pointerLimit() {
+	return pointerWidth == 2 ? 0xFFFF : END_BLOCK;
+}
+
+/**
+ * Jumlah file yang merujuk sebuah blok
+ * @param  position blok
+ * @return          0 untuk blok kosong
+ */
+Block POI::refCount(Block position) {
+	MutexGuard guard(metaLock);
+	Block value = nextBlock[position];
+	if (value == EMPTY_BLOCK) {
 		return 0;
 	}
-	/* kalau offset >= BLOCK_SIZE */
-	if (offset >= BLOCK_SIZE) {
-		return readBlock(nextBlock[position], buffer, size, offset - BLOCK_SIZE);
+	if (value == END_BLOCK || value < capacity) {
+		return 1;
 	}
+	return pointerLimit() - value + 1;
+}
 
-	file.seekg(BLOCK_SIZE * DATA_POOL_OFFSET + position * BLOCK_SIZE + offset);
-	int size_now = size;
-	/* cuma bisa baca sampai sebesar block size */
-	if (offset + size_now > BLOCK_SIZE) {
-		size_now = BLOCK_SIZE - offset;
+/**
+ * Menambah satu referensi ke sederet blok data, semua atau tidak sama
+ * sekali
+ * @param  start  blok pertama
+ * @param  length jumlah blok
+ * @return        false jika referensi salah satu blok sudah maksimum
+ */
+bool POI::shareRange(Block start, Block length) {
+	MutexGuard guard(metaLock);
+	Block limit = pointerLimit() >= capacity ? pointerLimit() - capacity + 1 : 0;
+	for (Block i = 0; i < length; i++) {
+		if (refCount(start + i) >= limit) {
+			return false;
+		}
 	}
-	file.read(buffer, size_now);
-
-	/* kalau size > block size, lanjutkan di nextBlock */
-	if (offset + size > BLOCK_SIZE) {
-		return size_now + readBlock(nextBlock[position], buffer + BLOCK_SIZE, offset + size - BLOCK_SIZE);
+	for (Block i = 0; i < length; i++) {
+		Block refs = refCount(start + i);
+		if (refs == 1) {
+			sharedBlocks++;
+		}
+		setNextBlock(start + i, pointerLimit() - refs);
 	}
-
-	return size_now;
+	return true;
 }
 
 /**
- * Menuliskan isi buffer ke filesystem
- * @param  position
- * @param  buffer
- * @param  size
- * @param  offset
- * @return
+ * Copy-on-write: blok dalam rentang tulis yang masih dipakai bersama
+ * diganti blok baru milik file ini. Isi lama disalin kecuali blok akan
+ * ditimpa seluruhnya. Extent belum disimpan.
+ * @param  extents extent file
+ * @param  offset  offset byte awal penulisan
+ * @param  size    jumlah byte
+ * @return         true jika extent berubah
  */
-int POI::writeBlock(Block position, const char *buffer, int size, int offset) {
-	/* kalau sudah di END_BLOCK, return */
-	if (position == END_BLOCK) {
-		return 0;
+bool POI::unshareExtents(ExtentList &extents, off_t offset, size_t size) {
+	if (sharedBlocks == 0 || size == 0) {
+		return false;
 	}
-	/* kalau offset >= BLOCK_SIZE */
-	if (offset >= BLOCK_SIZE) {
-		/* kalau nextBlock tidak ada, alokasikan */
-		if (nextBlock[position] == END_BLOCK) {
-			setNextBlock(position, allocateBlock());
+
+	bool changed = false;
+	vector<char> buffer;
+	Block last = (offset + size - 1) / blockSize;
+	for (Block block = offset / blockSize; block <= last; block++) {
+		Block old = extents.map(block);
+		if (old == END_BLOCK || refCount(old) < 2) {
+			continue;
 		}
-		return writeBlock(nextBlock[position], buffer, size, offset - BLOCK_SIZE);
+
+		Block previous = block > 0 ? extents.map(block - 1) : END_BLOCK;
+		Block position = allocateBlock(previous == END_BLOCK ? END_BLOCK : previous + 1);
+		off_t begin = (off_t)block * blockSize;
+		if (begin < offset || begin + blockSize > offset + (off_t)size) {
+			buffer.resize(blockSize);
+			readPool(old, 0, &buffer[0], blockSize);
+			writePool(position, 0, &buffer[0], blockSize);
+		}
+		freeRange(old, 1);
+		extents.replace(block, position);
+		changed = true;
 	}
+	return changed;
+}
 
-	file.seekp(BLOCK_SIZE * DATA_POOL_OFFSET + position * BLOCK_SIZE + offset);
-	int size_now = size;
-	if (offset + size_now > BLOCK_SIZE) {
-		size_now = BLOCK_SIZE - offset;
+/**
+ * Menyalin isi file source ke target (file kosong) tanpa menyalin blok:
+ * extent target menunjuk blok yang sama dan referensinya bertambah,
+ * blok baru dibuat saat salah satu file menulis (copy-on-write). Hanya
+ * rantai overflow extent yang dibuat untuk target. Entry target belum
+ * ditulis.
+ * @param  source entry file sumber
+ * @param  target entry file tujuan
+ * @return        false jika blok tidak bisa dipakai bersama (format v1
+ *                atau referensi maksimum), isi harus disalin
+ */
+bool POI::cloneFile(Entry &source, Entry &target) {
+	if (version != VOLUME_VERSION_EXTENT) {
+		return false;
 	}
-	file.write(buffer, size_now);
+	MutexGuard guard(metaLock);
 
-	/* kalau size > block size, lanjutkan di nextBlock */
-	if (offset + size > BLOCK_SIZE) {
-		/* kalau nextBlock tidak ada, alokasikan */
-		if (nextBlock[position] == END_BLOCK) {
-			setNextBlock(position, allocateBlock());
+	memset(target.data + entryBase, 0, EXTENT_INLINE_COUNT * 2 * pointerWidth);
+	if (inlineCapacity > 0) {
+		memset(target.data + inlineOffset, 0, entrySize - inlineOffset);
+	}
+	target.setIndex(END_BLOCK);
+	target.setSize(source.getSize());
+
+	/* isi inline cukup disalin */
+	if (isInline(source)) {
+		memcpy(target.data + inlineOffset, source.data + inlineOffset, entrySize - inlineOffset);
+		target.setAttr(target.getAttr() | ATTR_INLINE);
+		return true;
+	}
+	target.setAttr(target.getAttr() & ~ATTR_INLINE);
+
+	ExtentList extents;
+	extents.load(source);
+	for (size_t i = 0; i < extents.extents.size(); i++) {
+		if (!shareRange(extents.extents[i].start, extents.extents[i].length)) {
+			/* batalkan referensi yang sudah ditambahkan */
+			for (size_t j = 0; j < i; j++) {
+				freeRange(extents.extents[j].start, extents.extents[j].length);
+			}
+			target.setSize(0);
+			return false;
 		}
-		return size_now + writeBlock(nextBlock[position], buffer + BLOCK_SIZE, offset + size - BLOCK_SIZE);
 	}
 
-	return size_now;
+	ExtentList copy;
+	copy.assign(extents);
+	copy.store(target);
+	extentGeneration++;
+	return true;
 }
 
 ////////////////////////////
@@ -344,7 +1947,7 @@ int POI::writeBlock(Block position, const char *buffer, int size, int offset) {
 Entry::Entry() {
 	position = 0;
 	offset = 0;
-	memset(data, 0, ENTRY_SIZE);
+	memset(data, 0, ENTRY_MAX_SIZE);
 }
 
 /**
@@ -352,152 +1955,44 @@ Entry::Entry() {
  * @param position
  * @param offset
  */
-Entry::Entry(Block position, unsigned char offset) {
+Entry::Entry(Block position, unsigned short offset) {
 	this->position = position;
 	this->offset = offset;
 
-	/* baca dari data pool */
-	filesystem.file.seekg(BLOCK_SIZE * DATA_POOL_OFFSET + position * BLOCK_SIZE + offset * ENTRY_SIZE);
-	filesystem.file.read(data, ENTRY_SIZE);
-}
-
-/**
- * Mendapatkan Entry berikutnya
- * @return
- */
-Entry Entry::nextEntry() {
-	if (offset < 15) {
-		return Entry(position, offset + 1);
-	}
-	else {
-		return Entry(filesystem.nextBlock[position], 0);
-	}
-}
-
-/**
- * Mendapatkan Entry dari path
- * @param  path
- * @return
- */
-Entry Entry::getEntry(const char *path) {
-	/* mendapatkan direktori teratas */
-	unsigned int endstr = 1;
-	while (path[endstr] != '/' && endstr < strlen(path)) {
-		endstr++;
-	}
-	string topDirectory = string(path + 1, endstr - 1);
-
-	/* mencari entri dengan nama topDirectory */
-	while (getName() != topDirectory && position != END_BLOCK) {
-		*this = nextEntry();
+	/* END_BLOCK menandakan akhir direktori, tidak ada yang dibaca */
+	memset(data, 0, ENTRY_MAX_SIZE);
+	if (position == END_BLOCK) {
+		return;
 	}
 
-	/* kalau tidak ketemu, return Entry kosong */
-	if (isEmpty()) {
-		return Entry();
-	}
-	/* kalau ketemu, */
-	else {
-		if (endstr == strlen(path)) {
-			return *this;
-		}
-		else {
-			/* cek apakah direktori atau bukan */
-			if (getAttr() & 0x8) {
-				Block index;
-				memcpy((char*)&index, data + 0x1A, 2);
-				Entry next(index, 0);
-				return next.getEntry(path + endstr);
-			}
-			else {
-				return Entry();
-			}
-		}
-	}
+	/* baca dari data pool */
+	filesystem.readPool(position, offset * filesystem.entrySize, data, filesystem.entrySize);
 }
 
 /**
- * Mendapatkan Entry baru dari path
- * @param  path
- * @return
+ * Konstruktor dari isi blok yang sudah dibaca
+ * @param position
+ * @param offset
+ * @param data     entrySize byte data entry
  */
-Entry Entry::getNewEntry(const char *path) {
-	/* mendapatkan direktori teratas */
-	unsigned int endstr = 1;
-	while (path[endstr] != '/' && endstr < strlen(path)) {
-		endstr++;
-	}
-	string topDirectory = string(path + 1, endstr - 1);
-
-	/* mencari entri dengan nama topDirectory */
-	Entry entry(position, offset);
-	while (getName() != topDirectory && position != END_BLOCK) {
-		*this = nextEntry();
-	}
-
-	/* kalau tidak ketemu, buat entry baru */
-	if (isEmpty()) {
-		while (!entry.isEmpty()) {
-			if (entry.nextEntry().position == END_BLOCK) {
-				entry = Entry(filesystem.allocateBlock(), 0);
-			}
-			else {
-				entry = entry.nextEntry();
-			}
-		}
-		/* beri atribut pada entry */
-		entry.setName(topDirectory.c_str());
-		entry.setAttr(0xF);
-		entry.setIndex(filesystem.allocateBlock());
-		entry.setSize(BLOCK_SIZE);
-		entry.setTime(0);
-		entry.setDate(0);
-		entry.write();
-
-		*this = entry;
-	}
-
-	if (endstr == strlen(path)) {
-		return *this;
-	}
-	else {
-		/* cek apakah direktori atau bukan */
-		if (getAttr() & 0x8) {
-			Block index;
-			memcpy((char*)&index, data + 0x1A, 2);
-			Entry next(index, 0);
-			return next.getNewEntry(path + endstr);
-		}
-		else {
-			return Entry();
-		}
-	}
+Entry::Entry(Block position, unsigned short offset, const char *data) {
+	this->position = position;
+	this->offset = offset;
+	memset(this->data, 0, ENTRY_MAX_SIZE);
+	memcpy(this->data, data, filesystem.entrySize);
 }
 
 /**
- * Mengembalikan entry kosong selanjutnya
- * Jika blok penuh akan dibuat entri baru
+ * Mendapatkan Entry berikutnya
  * @return
  */
-Entry Entry::getNextEmptyEntry() {
-	Entry entry(*this);
-
-	while (!entry.isEmpty()) {
-		entry = entry.nextEntry();
+Entry Entry::nextEntry() {
+	if (offset < filesystem.entryPerBlock - 1) {
+		return Entry(position, offset + 1);
 	}
-	if (entry.position == END_BLOCK) {
-		/* berarti blok saat ini sudah penuh, buat blok baru */
-		Block newPosition = filesystem.allocateBlock();
-		Block lastPos = position;
-		while (filesystem.nextBlock[lastPos] != END_BLOCK) {
-			lastPos = filesystem.nextBlock[lastPos];
-		}
-		filesystem.setNextBlock(lastPos, newPosition);
-		entry.position = newPosition;
-		entry.offset = 0;
+	else {
+		return Entry(filesystem.nextBlock[position], 0);
 	}
-
-	return entry;
 }
 
 /**
@@ -540,15 +2035,22 @@ short Entry::getDate() {
 	return result;
 }
 
+/* entry lebar (pointer 32 bit) menyimpan index dan ukuran setelah 0x20 */
 Block Entry::getIndex() {
-	Block result;
-	memcpy((char*)&result, data + 0x1A, 2);
-	return result;
+	if (filesystem.pointerWidth == 2) {
+		return filesystem.getPointer(data + 0x1A);
+	}
+	return filesystem.getPointer(data + ENTRY_WIDE_INDEX);
 }
 
-int Entry::getSize() {
-	int result;
-	memcpy((char*)&result, data + 0x1C, 4);
+off_t Entry::getSize() {
+	if (filesystem.pointerWidth == 2) {
+		unsigned int result;
+		memcpy((char*)&result, data + 0x1C, 4);
+		return result;
+	}
+	long long result;
+	memcpy((char*)&result, data + ENTRY_WIDE_SIZE, 8);
 	return result;
 }
 
@@ -569,11 +2071,23 @@ void Entry::setDate(const short date) {
 }
 
 void Entry::setIndex(const Block index) {
-	memcpy(data + 0x1A, (char*)&index, 2);
+	if (filesystem.pointerWidth == 2) {
+		filesystem.setPointer(data + 0x1A, index);
+	}
+	else {
+		filesystem.setPointer(data + ENTRY_WIDE_INDEX, index);
+	}
 }
 
-void Entry::setSize(const int size) {
-	memcpy(data + 0x1C, (char*)&size, 4);
+void Entry::setSize(const off_t size) {
+	if (filesystem.pointerWidth == 2) {
+		unsigned int narrow = (unsigned int)size;
+		memcpy(data + 0x1C, (char*)&narrow, 4);
+	}
+	else {
+		long long wide = size;
+		memcpy(data + ENTRY_WIDE_SIZE, (char*)&wide, 8);
+	}
 }
 
 /** Bagian Date Time */
@@ -581,9 +2095,11 @@ time_t Entry::getDateTime() {
 	unsigned int datetime;
 	memcpy((char*)&datetime, data + 0x16, 4);
 
+	/* localtime_r karena localtime memakai buffer bersama antar thread */
 	time_t rawtime;
 	time(&rawtime);
-	struct tm *result = localtime(&rawtime);
+	struct tm local;
+	struct tm *result = localtime_r(&rawtime, &local);
 
 	result->tm_sec = datetime & 0x1F;
 	result->tm_min = (datetime >> 5) & 0x3F;
@@ -598,7 +2114,8 @@ time_t Entry::getDateTime() {
 void Entry::setCurrentDateTime() {
 	time_t now_t;
 	time(&now_t);
-	struct tm *now = localtime(&now_t);
+	struct tm local;
+	struct tm *now = localtime_r(&now_t, &local);
 
 	int sec = now->tm_sec;
 	int min = now->tm_min;
@@ -619,7 +2136,35 @@ void Entry::setCurrentDateTime() {
  */
 void Entry::write() {
 	if (position != END_BLOCK) {
-		filesystem.file.seekp(BLOCK_SIZE * DATA_POOL_OFFSET + position * BLOCK_SIZE + offset * ENTRY_SIZE);
-		filesystem.file.write(data, ENTRY_SIZE);
+		filesystem.writeMetadata(position, offset * filesystem.entrySize, data, filesystem.entrySize);
+		filesystem.dentry.update(*this);
+		filesystem.handles.update(*this);
 	}
 }
+
+////////////////////////////////////
+// Realisasi Kelas ChainCursor    //
+////////////////////////////////////
+
+/**
+ * Konstruktor, cursor belum menunjuk rantai manapun
+ */
+ChainCursor::ChainCursor() {
+	first = END_BLOCK;
+	offset = 0;
+	position = END_BLOCK;
+	generation = 0;
+}
+
+////////////////////////////////////
+// Realisasi Kelas Readahead      //
+////////////////////////////////////
+
+/**
+ * Konstruktor, baca pertama dari awal file dianggap berurutan
+ */
+Readahead::Readahead() {
+	next = 0;
+	ahead = 0;
+	window = 0;
+}
@@ -7,25 +7,725 @@
 
 #include <cstdlib>
 #include <cstring>
+#include <climits>
 #include <string>
+#include <algorithm>
 #include <fstream>
 #include <ctime>
+#include <sys/types.h>
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+#include <pthread.h>
 
 /** Definisi tipe **/
-typedef unsigned short Block;
+typedef unsigned int Block;	// di volume 2 atau 4 byte sesuai pointerWidth
+
+/* Deretan blok berurutan milik file (format v2) */
+struct Extent {
+	Block start;
+	Block length;
+};
+
+/* Potongan isi file yang berurutan di file .poi, position -1 untuk lubang */
+struct Segment {
+	off_t position;
+	size_t size;
+};
+
+/* Satu baca/tulis dalam satu batch, posisi byte di file .poi */
+struct IORequest {
+	off_t position;
+	char *buffer;
+	size_t size;
+};
+
+/* Sebagian isi satu blok data pool untuk baca/tulis per batch */
+struct PoolRequest {
+	Block position;
+	int offset;
+	char *buffer;
+	int size;
+};
+
+struct io_uring_sqe;
+struct io_uring_cqe;
 
 /** Konstanta **/
 /* Konstanta ukuran */
-#define BLOCK_SIZE 512
-#define N_BLOCK 65536
-#define ENTRY_SIZE 32
-#define DATA_POOL_OFFSET 257
+#define HEADER_SIZE 512
+#define HEADER_NAME_SIZE 32		// nama volume di 0x04-0x23
+#define HEADER_MARK "poi+"		// di 0x48, field 0x30-0x47 berlaku
+#define POI_BLOCK_SIZE 512		// ukuran blok bawaan
+#define POI_BLOCK_SIZE_MAX 65536
+#define N_BLOCK 65536			// jumlah blok maksimum dengan pointer 16 bit
+#define SHARE_RESERVE 256		// blok bawaan yang tidak dibuat di volume v2 16 bit, untuk referensi blok bersama
+#define POINTER_WIDTH 2			// lebar pointer bawaan dalam byte
+#define ENTRY_SIZE 32			// entry dengan pointer 16 bit
+#define ENTRY_SIZE_WIDE 64		// entry dengan pointer 32 bit dan ukuran 64 bit
+#define ENTRY_MAX_SIZE 256		// entry format v2 dengan isi inline
+#define ENTRY_INLINE_SIZE 256		// ukuran entry volume VOLUME_INLINE_DATA
+/* Konstanta untuk entry lebar */
+#define ENTRY_WIDE_INDEX 0x20
+#define ENTRY_WIDE_SIZE 0x24
 /* Konstanta untuk Block */
 #define EMPTY_BLOCK 0x0000
-#define END_BLOCK 0xFFFF
+#define END_BLOCK 0xFFFFFFFF
+/* Konstanta untuk versi format volume */
+#define VOLUME_VERSION_FAT 1
+#define VOLUME_VERSION_EXTENT 2
+/* Konstanta untuk extent (format v2), area inline setelah entry dasar */
+#define EXTENT_INLINE_COUNT 8
+/* Konstanta untuk atribut entry */
+#define ATTR_HASHED 0x10
+#define ATTR_INLINE 0x20		// isi file disimpan di dalam entry
+/* Konstanta untuk flag volume */
+#define VOLUME_HASHED_ROOT 0x1
+#define VOLUME_HASHED_DIRS 0x2
+#define VOLUME_INLINE_DATA 0x4		// format v2, file kecil disimpan di entry
+/* Konstanta untuk direktori hashed, bucket per blok = pointerPerBlock */
+#define HASH_MAX_TABLE_BLOCKS 64
+#define HASH_MAX_CHAIN 2
+#define HASH_UPGRADE_BLOCKS 4
+/* Konstanta untuk backend */
+#define BACKEND_STREAM 0
+#define BACKEND_MMAP 1
+#define BACKEND_URING 2
+#define URING_DEPTH 64			// permintaan io_uring yang berjalan bersamaan
+/* Konstanta untuk cache */
+#define DENTRY_CAPACITY 16384
+#define BLOCK_CACHE_BUDGET (4 * 1024 * 1024)
+/* Konstanta untuk readahead, dalam byte */
+#define READAHEAD_MIN (16 * 1024)	// jendela awal
+#define READAHEAD_MAX (256 * 1024)	// jendela maksimum bawaan
+/* Konstanta penulisan metadata */
+#define METADATA_SYNC_INTERVAL 5	// detik
+#define FLUSH_CHECK_INTERVAL 1		// detik antar pemeriksaan flusher
+#define FAT_READ_CHUNK (1 << 20)	// byte per pembacaan allocation table
+#define LINK_COPY_SIZE (1 << 20)	// byte per salinan link jika blok tidak bisa dipakai bersama
+#define DEFRAG_CHUNK (1 << 20)		// byte per salinan saat memindah isi file
+#define DEFRAG_INTERVAL 3600		// detik antar putaran defragmentasi bawaan
+#define ZERO_CHUNK (1 << 20)		// byte per penulisan nol jika hole punching tidak didukung
+/* Konstanta pemeriksa volume (poi-fsck), kode keluar seperti fsck */
+#define FSCK_CLEAN 0			// volume konsisten
+#define FSCK_REPAIRED 1			// semua kesalahan sudah diperbaiki
+#define FSCK_UNCORRECTED 4		// masih ada kesalahan
+#define FSCK_FAILED 8			// volume tidak bisa dibuka
+#define FSCK_SCAN_CHUNK 65536		// pointer allocation table per tugas thread
+#define FSCK_CHAIN_REF 0x80000000	// bit rujukan dari rantai, bit lain rujukan extent
+/* Konstanta untuk journal metadata */
+#define DURABILITY_NONE 0		// metadata ditulis langsung tanpa journal
+#define DURABILITY_GROUP 1		// group commit paling lambat setiap syncInterval
+#define DURABILITY_OP 2			// commit dan fsync di akhir setiap operasi
+#define JOURNAL_MIN_SIZE (1 << 20)	// byte, dibatasi 1/16 blok bebas
+#define JOURNAL_MAX_SIZE (64 << 20)	// byte
+#define JOURNAL_RECORD_HEADER 12	// posisi 8 byte dan ukuran 4 byte
+/* Offset readdir: 1 dan 2 untuk "." dan "..", 3 untuk STATS_PATH di root,
+   entry direktori mulai dari READDIR_OFFSET + posisi slot sesudahnya */
+#define READDIR_OFFSET 3
+#define READDIR_PAGE 128		// entry minimum yang dibaca per langkah readdir
+/* Konstanta cache kernel (opsi fuse) */
+#define KERNEL_TIMEOUT 1		// detik entry dan atribut disimpan kernel, bawaan libfuse
+#define KERNEL_NEGATIVE_TIMEOUT 0	// detik entry negatif disimpan kernel, bawaan libfuse
+#define KERNEL_IO_MAX (128 * 1024)	// byte per permintaan baca/tulis fuse
+/* Konstanta untuk statistik */
+#define STATS_PATH "/.poi-stats"	// file virtual di root, isinya dibuat saat dibuka
+#define STATS_BUCKETS 48		// bucket histogram, bucket ke-i [2^i, 2^(i+1)) nanodetik
+/* Operasi fuse yang dicatat */
+#define OP_GETATTR 0
+#define OP_READDIR 1
+#define OP_MKDIR 2
+#define OP_MKNOD 3
+#define OP_READ 4
+#define OP_READ_BUF 5
+#define OP_RMDIR 6
+#define OP_UNLINK 7
+#define OP_RENAME 8
+#define OP_WRITE 9
+#define OP_WRITE_BUF 10
+#define OP_TRUNCATE 11
+#define OP_CHMOD 12
+#define OP_LINK 13
+#define OP_OPEN 14
+#define OP_RELEASE 15
+#define OP_UTIMENS 16
+#define OP_FSYNC 17
+#define OP_IOCTL 18
+#define OP_FALLOCATE 19
+#define OP_COUNT 20
+/* Panggilan backend yang dicatat */
+#define IO_READ 0
+#define IO_WRITE 1
+#define IO_SYNC 2
+#define IO_SUBMIT 3			// satu io_uring_enter
+#define IO_COUNT 4
 
 using namespace std;
 
+class Entry;
+class Directory;
+class ChainCursor;
+class FileHandle;
+class ExtentList;
+
+/* Penulisan metadata ke posisi byte di file .poi */
+struct MetadataWrite {
+	off_t position;
+	vector<char> data;
+};
+
+/**
+ * Class Mutex
+ * pembungkus pthread_mutex_t; <mutex> tidak dipakai karena
+ * std::filesystem bentrok dengan objek global filesystem
+ */
+class Mutex {
+public:
+	Mutex(bool recursive = false);
+	~Mutex();
+	void lock();
+	void unlock();
+
+private:
+	Mutex(const Mutex &);
+	pthread_mutex_t mutex;
+};
+
+/**
+ * Class RWLock
+ * pembungkus pthread_rwlock_t, banyak pembaca atau satu penulis
+ */
+class RWLock {
+public:
+	RWLock();
+	~RWLock();
+	void lock();
+	void lockShared();
+	void unlock();
+
+private:
+	RWLock(const RWLock &);
+	pthread_rwlock_t rwlock;
+};
+
+/**
+ * Class MutexGuard
+ * memegang Mutex selama objek hidup
+ */
+class MutexGuard {
+public:
+	MutexGuard(Mutex &mutex) : mutex(mutex) { mutex.lock(); }
+	~MutexGuard() { mutex.unlock(); }
+
+private:
+	Mutex &mutex;
+};
+
+/**
+ * Class RWGuard
+ * memegang RWLock (bersama atau eksklusif) selama objek hidup
+ */
+class RWGuard {
+public:
+	RWGuard(RWLock &rwlock, bool exclusive) : rwlock(rwlock) {
+		if (exclusive) {
+			rwlock.lock();
+		}
+		else {
+			rwlock.lockShared();
+		}
+	}
+	~RWGuard() { rwlock.unlock(); }
+
+private:
+	RWLock &rwlock;
+};
+
+/**
+ * Class Storage
+ * backend akses file .poi, posisi dalam byte dari awal file
+ */
+class Storage {
+public:
+	virtual ~Storage() {}
+	virtual void read(off_t position, char *buffer, size_t size) = 0;
+	virtual void write(off_t position, const char *buffer, size_t size) = 0;
+	virtual void sync() = 0;
+	virtual off_t size() = 0;
+	virtual int descriptor() = 0;
+	virtual char *pointer(off_t position) { return NULL; }
+	virtual void zero(off_t position, off_t size);
+
+	/* banyak baca/tulis sekaligus, bawaan satu per satu */
+	virtual void readBatch(vector<IORequest> &requests);
+	virtual void writeBatch(vector<IORequest> &requests);
+};
+
+/**
+ * Class StreamStorage
+ * backend pread/pwrite posisional, tidak ada posisi seek bersama
+ * sehingga aman dipakai banyak thread
+ */
+class StreamStorage : public Storage {
+public:
+	StreamStorage(const char *filename);
+	~StreamStorage();
+	void read(off_t position, char *buffer, size_t size);
+	void write(off_t position, const char *buffer, size_t size);
+	void sync();
+	off_t size();
+	int descriptor();
+
+private:
+	int fd;
+};
+
+/**
+ * Class UringStorage
+ * backend pread/pwrite yang mengirim batch baca/tulis sekaligus melalui
+ * io_uring (syscall langsung, tanpa liburing); jika io_uring tidak
+ * tersedia, batch dikerjakan satu per satu dengan pread/pwrite
+ */
+class UringStorage : public StreamStorage {
+public:
+	UringStorage(const char *filename, unsigned int depth);
+	~UringStorage();
+	void readBatch(vector<IORequest> &requests);
+	void writeBatch(vector<IORequest> &requests);
+	bool available();
+
+private:
+	bool setup(unsigned int depth);
+	void submit(vector<IORequest> &requests, int opcode);
+
+	int ring;			// fd io_uring, -1 jika tidak tersedia
+	unsigned int entries;		// ukuran submission queue
+	char *sqRing;			// pemetaan submission queue
+	char *cqRing;			// pemetaan completion queue
+	size_t sqRingSize;
+	size_t cqRingSize;
+	io_uring_sqe *sqes;		// larik entry submission
+	size_t sqesSize;
+	unsigned int *sqHead, *sqTail, *sqMask, *sqArray;
+	unsigned int *cqHead, *cqTail, *cqMask;
+	io_uring_cqe *cqes;
+	Mutex lock;			// satu batch dalam satu waktu
+};
+
+/**
+ * Class MmapStorage
+ * backend yang memetakan seluruh file .poi ke memori,
+ * baca/tulis menjadi akses memori biasa
+ */
+class MmapStorage : public Storage {
+public:
+	MmapStorage(const char *filename);
+	~MmapStorage();
+	void read(off_t position, char *buffer, size_t size);
+	void write(off_t position, const char *buffer, size_t size);
+	void sync();
+	off_t size();
+	int descriptor();
+	char *pointer(off_t position);
+
+private:
+	int fd;
+	char *base;
+	size_t length;
+};
+
+/**
+ * Class BlockCache
+ * cache blok data pool dengan batas memori, eviksi CLOCK
+ * dan write-back untuk blok yang dirty
+ */
+class BlockCache {
+public:
+/* Method */
+	BlockCache();
+	void setBudget(size_t bytes);
+
+	/* baca/tulis sebagian isi satu blok */
+	void read(Block position, char *buffer, int size, int offset);
+	void write(Block position, const char *buffer, int size, int offset);
+
+	/* write-back semua blok dirty, lalu kosongkan jika perlu */
+	void flush();
+	void clear();
+	void sync(Block position, bool discard);
+
+	void read(vector<PoolRequest> &requests);
+
+	/* baca deret blok berurutan sekaligus sebelum dibutuhkan */
+	void prefetch(const vector<Extent> &runs);
+
+	bool enabled();
+	size_t capacity();
+	double hitRatio();
+
+/* Attributes */
+	unsigned long hits;		// akses yang dilayani cache
+	unsigned long misses;		// akses yang harus membaca volume
+	unsigned long evictions;	// blok yang dikeluarkan dari cache
+	unsigned long writebacks;	// blok dirty yang ditulis ke volume
+	size_t dirtyBytes;		// besar data dirty saat ini
+	unsigned long prefetched;	// blok yang dibaca oleh readahead
+	unsigned long readaheadHits;	// blok readahead yang kemudian dibaca
+	unsigned long readaheadWasted;	// blok readahead yang dibuang sebelum dibaca
+
+private:
+	struct Frame {
+		Block position;
+		bool dirty;
+		bool referenced;
+		bool prefetched;	// dimuat readahead, belum pernah dibaca
+		vector<char> data;
+	};
+
+	int lookup(Block position, bool load);
+	int install(Block position);
+	void load(const vector<Extent> &runs, bool prefetch);
+	void drop(Frame &frame);
+	int victim();
+	void writeBack(Frame &frame);
+
+	vector<Frame> frames;
+	unordered_map<Block, int> table;	// blok -> indeks frame
+	size_t budget;				// batas memori dalam byte
+	size_t hand;				// jarum CLOCK
+	Mutex lock;				// melindungi semua frame (rekursif)
+};
+
+/**
+ * Class DentryCache
+ * cache namespace di memori, menyimpan hasil lookup positif dan negatif
+ * dengan kunci path penuh maupun pasangan (blok parent, nama)
+ */
+class DentryCache {
+public:
+/* Method */
+	DentryCache();
+	void setCapacity(unsigned int capacity);
+
+	/* pencarian, true jika kunci ada di cache */
+	bool get(const string &path, Entry &entry);
+	bool get(Block parent, const string &name, Entry &entry);
+
+	/* penyimpanan hasil lookup */
+	void put(const string &path, Block parent, const Entry &entry);
+	void putNegative(const string &path);
+
+	/* sinkronisasi isi entry yang ditulis ulang */
+	void update(const Entry &entry);
+
+	/* invalidasi */
+	void invalidate(const string &path);
+	void invalidateTree(const string &path);
+	void invalidateDirectory(Block index);
+	void clear();
+
+/* Attributes */
+	unsigned long hits;		// lookup positif yang ditemukan
+	unsigned long negativeHits;	// lookup negatif yang ditemukan
+	unsigned long misses;		// lookup yang harus membaca direktori
+	unsigned long evictions;	// kunci yang dibuang karena kapasitas
+
+private:
+	/* data entry yang di-cache, dibagi oleh kunci path dan kunci parent */
+	struct Node {
+		char data[ENTRY_MAX_SIZE];
+		unsigned int refs;
+		string childKey;
+	};
+	struct Key {
+		unsigned long long location;
+		list<string>::iterator lru;
+	};
+
+	static unsigned long long locationOf(Block position, unsigned short offset);
+	static string childKey(Block parent, const string &name);
+	static string keyName(const string &key);
+
+	bool find(const string &key, Entry &entry);
+	void insert(const string &key, unsigned long long location, const char *data);
+	void erase(unordered_map<string, Key>::iterator it);
+	void eraseIf(bool (*match)(const string &key, const string &prefix), const string &prefix);
+
+	unordered_map<string, Key> keys;
+	unordered_map<unsigned long long, Node> nodes;
+	list<string> lru;		// depan = paling baru dipakai
+	unsigned int capacity;
+	Mutex lock;			// get juga mengubah urutan LRU
+};
+
+/**
+ * Class HandleTable
+ * daftar file yang sedang dibuka; salinan entry di setiap handle
+ * diperbarui saat entry ditulis atau dipindahkan
+ */
+class HandleTable {
+public:
+/* Method */
+	FileHandle *open(const Entry &entry);
+	void release(FileHandle *handle);
+
+	/* sinkronisasi salinan entry */
+	void update(const Entry &entry);
+	vector<FileHandle*> detach(const Entry &entry);
+	void attach(const vector<FileHandle*> &detached, const Entry &entry);
+
+private:
+	list<FileHandle*> handles;
+	Mutex lock;
+};
+
+/**
+ * Class LockTable
+ * reader/writer lock per file, dibuat saat dipakai dan dibuang
+ * saat tidak ada yang memegang; kunci berupa lokasi entry
+ */
+class LockTable {
+public:
+	void lock(unsigned long long key, bool exclusive);
+	void unlock(unsigned long long key);
+	static unsigned long long keyOf(const Entry &entry);
+
+private:
+	struct Lock {
+		RWLock rwlock;
+		int refs;
+		Lock() : refs(0) {}
+	};
+
+	unordered_map<unsigned long long, Lock> locks;
+	Mutex tableLock;
+};
+
+/**
+ * Class FileLock
+ * memegang lock file selama objek hidup
+ */
+class FileLock {
+public:
+	FileLock(const Entry &entry, bool exclusive);
+	~FileLock();
+
+private:
+	unsigned long long key;
+};
+
+/**
+ * Class Journal
+ * journal metadata pada deret blok data pool. Perubahan metadata dari
+ * banyak operasi dikumpulkan lalu ditulis sekaligus ke journal (group
+ * commit), baru kemudian ke lokasi aslinya; diputar ulang saat load.
+ */
+class Journal {
+public:
+/* Method */
+	Journal();
+	void attach(Block start, Block blocks);
+	void enable(bool enabled);
+	bool active();
+	bool replay();
+
+	/* blok metadata data pool yang menunggu commit */
+	void put(Block position, int offset, const char *buffer, int size);
+	bool read(Block position, int offset, char *buffer, int size);
+	void release(Block start, Block length);
+	void freedSpace(Block &available, Block &first);
+
+	void commit(vector<MetadataWrite> &writes);
+	size_t pendingBytes();
+	size_t capacity();
+
+/* Attributes */
+	Block start;			// blok pertama area journal, 0 jika tidak ada
+	Block blocks;			// panjang area journal dalam blok
+	unsigned long long sequence;	// nomor transaksi terakhir
+	unsigned long commits;		// jumlah group commit
+	unsigned long overflows;	// transaksi yang tidak muat di journal
+	unsigned long replays;		// transaksi yang diputar ulang saat load
+
+private:
+	static unsigned long long checksum(const char *data, size_t size);
+	void writeCommitBlock(unsigned long long length, unsigned long long sum);
+	void releaseFreed();
+
+	unordered_map<Block, vector<char> > pending;	// blok -> isi terbaru
+	vector<Extent> freed;		// blok yang dibebaskan transaksi ini
+	size_t pendingSize;		// byte metadata yang menunggu commit
+	bool enabled;
+	Mutex lock;			// pending dan freed
+};
+
+/**
+ * Class Transaction
+ * menandai satu operasi fuse yang mengubah metadata; commit journal
+ * hanya terjadi di antara operasi sehingga tidak memotong operasi
+ */
+class Transaction {
+public:
+	Transaction();
+	~Transaction();
+};
+
+/**
+ * Class Flusher
+ * thread latar belakang yang menulis perubahan tertunda setelah
+ * syncInterval walau tidak ada operasi berikutnya yang memicunya
+ */
+class Flusher {
+public:
+	Flusher();
+	void start();
+	void stop();
+
+private:
+	static void *run(void *arg);
+
+	pthread_t thread;
+	bool running;
+	atomic<bool> stopping;		// thread diminta berhenti
+};
+
+/**
+ * Class Histogram
+ * jumlah, byte, panggilan backend dan sebaran latensi satu jenis
+ * operasi; counter atomik sehingga dicatat tanpa lock
+ */
+class Histogram {
+public:
+	Histogram();
+	void record(unsigned long long nanoseconds, unsigned long long bytes, unsigned long calls);
+	unsigned long long percentile(double p);
+
+	atomic<unsigned long> count;
+	atomic<unsigned long long> bytes;
+	atomic<unsigned long long> ioCalls;
+	atomic<unsigned long long> totalTime;	// nanodetik
+	atomic<unsigned long long> maxTime;	// nanodetik
+	atomic<unsigned long> buckets[STATS_BUCKETS];
+};
+
+/**
+ * Class Stats
+ * histogram setiap operasi fuse dan panggilan backend (pread, pwrite,
+ * fsync, msync, io_uring_enter), dibaca melalui file virtual STATS_PATH
+ */
+class Stats {
+public:
+	Histogram ops[OP_COUNT];
+	Histogram io[IO_COUNT];
+
+	/* isi file statistik, satu baris key=value per operasi */
+	string report();
+
+	/* jam monotonic dalam nanodetik */
+	static unsigned long long now();
+
+	/* panggilan backend oleh thread ini sejak thread dimulai */
+	static thread_local unsigned long ioCalls;
+};
+
+/**
+ * Class StatTimer
+ * mencatat latensi satu operasi ke histogram saat objek dihancurkan,
+ * beserta panggilan backend thread ini selama operasi
+ */
+class StatTimer {
+public:
+	StatTimer(Histogram &histogram);
+	~StatTimer();
+
+	unsigned long long bytes;	// byte yang dipindahkan operasi
+
+private:
+	Histogram &histogram;
+	unsigned long long start;
+	unsigned long calls;
+};
+
+/**
+ * Class Allocator
+ * bitmap blok bebas di memori, dibangun ulang dari allocation table
+ * saat load; pencarian per 64 bit
+ */
+class Allocator {
+public:
+/* Method */
+	Allocator();
+	void load(const Block *table, Block count);
+
+	Block allocate(Block hint);
+	Block allocateRun(int &length, Block hint);
+	void release(Block position);
+	void releaseRun(Block start, int length);
+
+	bool isFree(Block position);
+	int longestRun(int max);
+	Block count();
+	Block first();
+
+private:
+	void mark(Block position, bool used);
+	Block findFree(Block from, Block to);
+	int runLength(Block start, int max);
+
+	vector<unsigned long long> bitmap;	// bit 1 = blok terpakai
+	Block total;				// jumlah blok volume
+	Block freeBlocks;			// jumlah blok bebas
+	Block rover;				// posisi awal pencarian berikutnya
+	Block lowest;				// tidak ada blok bebas di bawah ini
+};
+
+/**
+ * Class Defragmenter
+ * defragmentasi online: isi file dipindah ke deret blok berurutan dan
+ * slot kosong direktori dipadatkan, dijalankan thread latar belakang
+ * dengan batas kecepatan agar I/O pengguna tidak terganggu
+ */
+class Defragmenter {
+public:
+/* Method */
+	Defragmenter();
+	void start();
+	void stop();
+	void pass();
+	string report();
+
+/* Attributes */
+	bool enabled;			// dijalankan saat mount
+	unsigned int rate;		// batas pemindahan data dalam MB/detik, 0 = tanpa batas
+	int interval;			// detik antar putaran
+	atomic<bool> stopping;		// thread diminta berhenti
+
+	/* hasil putaran terakhir */
+	double scoreBefore;		// skor fragmentasi sebelum putaran
+	double scoreAfter;		// skor fragmentasi setelah putaran
+	unsigned long passes;		// jumlah putaran selesai
+	unsigned long filesMoved;	// file yang dipindah
+	unsigned long blocksMoved;	// blok data yang disalin
+	unsigned long directoryBlocksFreed;	// blok direktori yang dibebaskan
+
+private:
+	static void *run(void *arg);
+	double measure();
+	Block relocateFile(const string &path);
+	Block compactDirectory(const string &path);
+	void listDirectory(const string &path, vector<string> &files, vector<string> &directories);
+	bool openDirectory(const string &path, Directory &directory);
+	static string childPath(const string &parent, const string &name);
+	void throttle(Block blocks);
+	void sleep(double seconds);
+
+	pthread_t thread;
+	bool running;
+	unsigned long long started;	// awal putaran, nanodetik
+	unsigned long long moved;	// byte yang disalin di putaran ini
+};
+
 /**
  * Class POI
  * kelas filesystem
@@ -38,37 +738,135 @@ public:
 	~POI();
 
 	/* buat file *.poi */
-	void create(const char *filename);
-	void initVolumeInformation(const char *filename);
-	void initAllocationTable();
-	void initDataPool();
+	void create(const char *filename, int flags = 0, int version = VOLUME_VERSION_FAT,
+		int blockSize = POI_BLOCK_SIZE, int pointerWidth = POINTER_WIDTH, Block blocks = 0);
+	void setGeometry(int blockSize, int pointerWidth, Block blocks);
+	void initVolumeInformation(Storage &file, const char *filename);
+	void initAllocationTable(Storage &file);
+	void initDataPool(Storage &file);
 
 	/* baca file *.poi */
 	void load(const char *filename);
+	void flush();
+	void close();
 	void readVolumeInformation();
 	void readAllocationTable();
 
 	void writeVolumeInformation();
 	void writeAllocationTable(Block position);
+	void metadataChanged();
+	void flushMetadata();
+	void collectMetadata(vector<MetadataWrite> &writes);
 
+	/* journal metadata */
+	void openJournal();
+	void createJournal();
+	void endOperation();
+	void flushExpired();
+
+	/* pointer blok di volume, 2 atau 4 byte */
+	Block getPointer(const char *data);
+	void setPointer(char *data, Block value);
+	off_t maxFileSize();
 	/* bagian alokasi block */
 	void setNextBlock(Block position, Block next);
-	Block allocateBlock();
+	Block allocateBlock(Block hint = END_BLOCK);
+	Block allocateRun(int &length, Block hint = END_BLOCK);
+	Block allocateChain(Block count, Block hint = END_BLOCK);
 	void freeBlock(Block position);
+	void releaseBlocks(Block start, Block length);
+
+	/* lookup path melalui dentry cache */
+	Entry lookup(const char *path);
 
 	/* bagian baca/tulis block */
-	int readBlock(Block position, char *buffer, int size, int offset = 0);
-	int writeBlock(Block position, const char *buffer, int size, int offset = 0);
+	off_t blockOffset(Block position);
+	Block seekBlock(Block first, off_t offset, ChainCursor &cursor, bool allocate, off_t end = -1);
+	void readPool(Block position, int offset, char *buffer, int size);
+	void writePool(Block position, int offset, const char *buffer, int size);
+	void writeMetadata(Block position, int offset, const char *buffer, int size);
+	void readPools(vector<PoolRequest> &requests);
+	void writePools(vector<PoolRequest> &requests);
+	void poolBatch(const vector<PoolRequest> &requests, vector<IORequest> &batch);
+	const char *blockPointer(Block position);
+	int readBlock(Block position, char *buffer, int size, off_t offset = 0, ChainCursor *cursor = NULL);
+	int writeBlock(Block position, const char *buffer, int size, off_t offset = 0, ChainCursor *cursor = NULL);
+
+	/* bagian isi file, rantai FAT (v1), extent (v2) atau inline di entry */
+	void initFile(Entry &entry);
+	bool isInline(Entry &entry);
+	void expandInline(FileHandle &handle);
+	int readFile(FileHandle &handle, char *buffer, int size, off_t offset);
+	void readahead(FileHandle &handle, off_t offset, int size);
+	void prefetchFile(FileHandle &handle, Block first, Block count);
+	int writeFile(FileHandle &handle, const char *buffer, int size, off_t offset);
+	void mapFile(FileHandle &handle, size_t size, off_t offset, bool write, vector<Segment> &segments);
+	void finishWrite(Entry &entry, off_t end, bool changed);
+	bool allocateExtents(ExtentList &extents, off_t end);
+	bool allocateWrite(ExtentList &extents, off_t offset, off_t size);
+	void truncateFile(FileHandle &handle, off_t size);
+	bool preallocateFile(FileHandle &handle, off_t offset, off_t length, bool keepSize);
+	void punchFile(FileHandle &handle, off_t offset, off_t length);
+	void zeroBlocks(Block start, Block length);
+	void releaseFile(const Entry &entry);
+	void freeRange(Block start, Block length);
+
+	/* blok data v2 yang dipakai bersama beberapa file (copy-on-write) */
+	Block pointerLimit();
+	Block refCount(Block position);
+	bool shareRange(Block start, Block length);
+	bool unshareExtents(ExtentList &extents, off_t offset, size_t size);
+	bool cloneFile(Entry &source, Entry &target);
 
 /* Attributes */
-	fstream file;			// file .poi
-	Block nextBlock[N_BLOCK];	//pointer ke blok berikutnya
+	Storage *storage;		// backend file .poi
+	int backend;			// jenis backend (BACKEND_*)
+	unsigned int ioDepth;		// kedalaman antrean backend io_uring
+	vector<Block> nextBlock;	//pointer ke blok berikutnya
 
 	string filename;		// nama volume
-	int capacity;			// kapasitas filesystem dalam blok
-	int available;			// jumlah slot yang masih kosong
-	int firstEmpty;			// slot pertama yang masih kosong
+	Block capacity;			// kapasitas filesystem dalam blok
+	Block available;		// jumlah slot yang masih kosong
+	Block firstEmpty;		// slot pertama yang masih kosong
+	Allocator allocator;		// bitmap blok bebas
+	int flags;			// fitur volume (VOLUME_*)
+	int version;			// versi format volume (VOLUME_VERSION_*)
+	int blockSize;			// ukuran blok dalam byte
+	int pointerWidth;		// lebar pointer blok di volume (2 atau 4 byte)
+	int pointerPerBlock;		// jumlah pointer dalam satu blok
+	Block fatBlocks;		// jumlah blok allocation table
+	int entryBase;			// ukuran entry tanpa area extent
+	int entrySize;			// ukuran entry sesuai versi format
+	int entryPerBlock;		// jumlah entry dalam satu blok
+	int inlineOffset;		// awal isi inline dalam entry
+	int inlineCapacity;		// byte isi inline, 0 jika volume tanpa VOLUME_INLINE_DATA
+	atomic<unsigned long> extentGeneration;	// bertambah setiap daftar extent berubah
 	time_t mount_time;		// waktu mounting, diisi di konstruktor
+	DentryCache dentry;		// cache namespace
+	BlockCache cache;		// cache blok data pool
+	int readaheadMax;		// jendela readahead maksimum dalam byte, 0 = mati
+	HandleTable handles;		// file yang sedang dibuka
+	atomic<unsigned long> chainGeneration;	// bertambah setiap ada rantai yang dibebaskan
+	atomic<unsigned long> sharedBlocks;	// blok data yang dirujuk lebih dari satu file
+
+	/* sinkronisasi antar thread fuse, urutan: namespaceLock, commitLock,
+	   lock file, handle, metaLock, lock journal, lalu lock cache */
+	RWLock namespaceLock;		// eksklusif untuk operasi yang mengubah direktori
+	RWLock commitLock;		// bersama selama operasi, eksklusif saat commit
+	LockTable fileLocks;		// lock per file untuk baca/tulis isi
+	Mutex metaLock;			// allocator, allocation table, header (rekursif)
+
+	vector<bool> fatDirty;		// blok allocation table yang belum ditulis
+	bool headerDirty;		// Volume Information belum ditulis
+	int syncInterval;		// detik antar penulisan metadata, 0 = langsung
+	time_t lastSync;		// waktu penulisan metadata terakhir
+	unsigned long metadataWrites;	// jumlah penulisan metadata ke volume
+	int durability;			// mode durabilitas metadata (DURABILITY_*)
+	int kernelTimeout;		// detik cache entry/atribut kernel, 0 = tidak disimpan
+	Journal journal;		// journal metadata
+	Flusher flusher;		// penulisan berkala perubahan tertunda
+	Stats stats;			// latensi operasi fuse dan backend
+	Defragmenter defrag;		// defragmentasi latar belakang
 };
 
 /**
@@ -78,11 +876,9 @@ class Entry {
 public:
 /* Method */
 	Entry();
-	Entry(Block position, unsigned char offset);
+	Entry(Block position, unsigned short offset);
+	Entry(Block position, unsigned short offset, const char *data);
 	Entry nextEntry();
-	Entry getEntry(const char *path);
-	Entry getNewEntry(const char *path);
-	Entry getNextEmptyEntry();
 
 	void makeEmpty();
 	int isEmpty();
@@ -92,14 +888,14 @@ public:
 	short getTime();
 	short getDate();
 	Block getIndex();
-	int getSize();
+	off_t getSize();
 
 	void setName(const char* name);
 	void setAttr(const unsigned char attr);
 	void setTime(const short time);
 	void setDate(const short date);
 	void setIndex(const Block index);
-	void setSize(const int size);
+	void setSize(const off_t size);
 
 	time_t getDateTime();
 	void setCurrentDateTime();
@@ -107,7 +903,190 @@ public:
 	void write();
 
 /* Attributes */
-	char data[ENTRY_SIZE];
+	char data[ENTRY_MAX_SIZE];
 	Block position;	//posisi blok
-	unsigned char offset;	//offset dalam satu blok (0..15)
+	unsigned short offset;	//offset dalam satu blok
+};
+
+/**
+ * Class ChainCursor
+ * posisi terakhir pada rantai blok, agar akses berurutan
+ * tidak menelusuri rantai dari awal
+ */
+class ChainCursor {
+public:
+	ChainCursor();
+
+	Block first;			// blok pertama rantai
+	off_t offset;			// offset byte awal blok position
+	Block position;			// blok pada offset
+	unsigned long generation;	// chainGeneration saat cursor dibuat
+};
+
+/**
+ * Class ExtentList
+ * daftar extent file format v2: inline di entry (setelah entry dasar),
+ * sisanya di rantai blok overflow yang ditunjuk index entry
+ */
+class ExtentList {
+public:
+/* Method */
+	ExtentList();
+	void load(Entry &entry);
+	void store(Entry &entry);
+
+	Block map(Block block);
+	Block blocks();
+	void append(Block position);
+	void truncate(Block blocks);
+	void replace(Block block, Block position);
+	void assign(const ExtentList &other);
+
+/* Attributes */
+	vector<Extent> extents;
+	vector<Block> starts;		// blok logis awal setiap extent
+	unsigned long generation;	// extentGeneration saat dimuat
+	bool loaded;
+
+private:
+	int firstDirty;			// extent pertama yang belum disimpan
+};
+
+/**
+ * Class Readahead
+ * deteksi baca berurutan per file yang dibuka; jendela prefetch
+ * membesar selama baca berurutan dan kembali nol pada baca acak
+ */
+class Readahead {
+public:
+	Readahead();
+
+	off_t next;			// offset yang diharapkan jika baca berurutan
+	Block ahead;			// blok logis pertama yang belum di-prefetch
+	Block window;			// besar jendela dalam blok, 0 = belum berurutan
+	ChainCursor cursor;		// posisi prefetch pada rantai (v1)
+};
+
+/**
+ * Class FileHandle
+ * state file yang sedang dibuka, disimpan di fuse_file_info::fh
+ */
+class FileHandle {
+public:
+	Entry entry;		// salinan entry (lokasi, ukuran, index)
+	ChainCursor cursor;	// posisi terakhir baca/tulis (v1)
+	ExtentList extents;	// daftar extent yang sudah dimuat (v2)
+	Readahead readahead;	// pola baca file ini
+	Mutex lock;		// cursor dan extent dipakai satu thread
+};
+
+/**
+ * Class Directory
+ * isi direktori, linear (rantai blok entry) atau hashed
+ * (tabel bucket di rantai blok index, tiap bucket rantai blok entry)
+ */
+class Directory {
+public:
+/* Method */
+	Directory();
+	Directory(Block index, bool hashed);
+	Directory(const Entry &owner);
+	static Directory root();
+	static Block create(bool hashed);
+
+	/* operasi isi direktori */
+	Entry find(const string &name);
+	Entry emptySlot(const string &name);
+	vector<Entry> list();
+	bool list(off_t cursor, size_t limit, vector<Entry> &result, vector<off_t> &next);
+	void release();
+
+	/* blok entry yang terpakai dan jumlah minimum untuk isinya */
+	void usage(Block &blocks, Block &minimum);
+	Block compact();
+
+/* Attributes */
+	Block index;	// blok pertama direktori
+	bool hashed;	// format hashed atau linear
+	bool isRoot;	// root tidak punya entry pemilik
+	Entry owner;	// entry pemilik direktori
+
+private:
+	static unsigned int hash(const string &name);
+	static Block newBlock(unsigned char fill, Block hint = END_BLOCK);
+
+	int bucketCount();
+	Block tableBlock(int bucket);
+	Block bucketHead(int bucket);
+	void setBucketHead(int bucket, Block head);
+
+	const char *readEntryBlock(Block position, char *buffer);
+	bool scanChain(Block position, const string *name, Entry &result, Block &last, int &length);
+	void listChain(Block position, vector<Entry> &result);
+	Block compactChain(Block head);
+	Entry emptySlot(const string &name, bool grow);
+	void rebuild(int buckets);
+};
+
+/**
+ * Class Checker
+ * pemeriksa volume offline (poi-fsck). Pohon direktori ditelusuri per
+ * tingkat dari blok 0 dan setiap rantai diperiksa oleh beberapa thread,
+ * lalu jumlah rujukan setiap blok dicocokkan dengan allocation table
+ * dan jumlah blok bebas di header.
+ */
+class Checker {
+public:
+/* Method */
+	Checker();
+	int run(bool repair);
+
+/* Attributes */
+	int threads;			// thread pemeriksa
+	vector<string> problems;	// kesalahan yang ditemukan, satu baris per kesalahan
+	unsigned long directories;	// direktori yang diperiksa
+	unsigned long files;		// file yang diperiksa
+	unsigned long structural;	// rantai, extent atau entry rusak; tidak diperbaiki
+	unsigned long accounting;	// blok bocor, jumlah referensi atau header salah
+	unsigned long repaired;		// pointer dan field header yang ditulis ulang
+	Block freeBlocks;		// blok bebas menurut allocation table
+	Block firstFree;		// blok bebas pertama, END_BLOCK jika penuh
+
+private:
+	/* direktori atau file yang menunggu diperiksa */
+	struct Node {
+		Entry entry;
+		Block index;
+		bool hashed;
+		string path;
+	};
+	/* nilai baru satu pointer allocation table */
+	struct Fix {
+		Block position;
+		Block value;
+	};
+	/* satu pemanggilan parallel */
+	struct Task {
+		Checker *checker;
+		void (Checker::*work)(size_t);
+		size_t count;
+		atomic<size_t> next;
+	};
+
+	void parallel(size_t count, void (Checker::*work)(size_t));
+	static void *worker(void *arg);
+	bool claimChain(Block first, const string &owner, vector<Block> &blocks);
+	bool isShared(Block value);
+	void checkDirectory(size_t i);
+	void checkFile(size_t i);
+	void scanTable(size_t i);
+	void problem(const string &message, bool repairable);
+
+	vector<atomic<Block> > refs;	// rujukan setiap blok (FSCK_CHAIN_REF dan jumlah extent)
+	vector<Node> level;		// direktori satu tingkat pohon
+	vector<Node> nextLevel;		// subdirektori tingkat berikutnya
+	vector<Node> pending;		// file di tingkat ini
+	vector<Fix> fixes;		// perbaikan allocation table
+	bool fixTable;			// perbaikan allocation table dijalankan
+	Mutex lock;			// problems, daftar node, fixes dan counter (rekursif)
 };
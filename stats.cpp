@@ -0,0 +1,176 @@
+//////////////////////////////////
+// File stats.cpp               //
+// Histogram latensi operasi    //
+//////////////////////////////////
+
+#include <cstdio>
+#include "poi.hpp"
+
+/* Global filesystem */
+extern POI filesystem;
+
+/* nama operasi, sesuai urutan OP_* dan IO_* */
+static const char *opNames[OP_COUNT] = {
+	"getattr", "readdir", "mkdir", "mknod", "read", "read_buf", "rmdir", "unlink", "rename",
+	"write", "write_buf", "truncate", "chmod", "link", "open", "release", "utimens", "fsync",
+	"ioctl", "fallocate"
+};
+static const char *ioNames[IO_COUNT] = {"read", "write", "sync", "submit"};
+
+thread_local unsigned long Stats::ioCalls = 0;
+
+//////////////////////////////////////
+// Realisasi Kelas Histogram        //
+//////////////////////////////////////
+
+/**
+ * Konstruktor, semua counter nol
+ */
+Histogram::Histogram() : count(0), bytes(0), ioCalls(0), totalTime(0), maxTime(0) {
+	for (int i = 0; i < STATS_BUCKETS; i++) {
+		buckets[i] = 0;
+	}
+}
+
+/**
+ * Mencatat satu operasi
+ * @param nanoseconds latensi
+ * @param bytes       byte yang dipindahkan
+ * @param calls       panggilan backend selama operasi
+ */
+void Histogram::record(unsigned long long nanoseconds, unsigned long long bytes, unsigned long calls) {
+	int bucket = nanoseconds == 0 ? 0 : 63 - __builtin_clzll(nanoseconds);
+	buckets[min(bucket, STATS_BUCKETS - 1)].fetch_add(1, memory_order_relaxed);
+	count.fetch_add(1, memory_order_relaxed);
+	totalTime.fetch_add(nanoseconds, memory_order_relaxed);
+	if (bytes != 0) {
+		this->bytes.fetch_add(bytes, memory_order_relaxed);
+	}
+	if (calls != 0) {
+		ioCalls.fetch_add(calls, memory_order_relaxed);
+	}
+
+	unsigned long long previous = maxTime.load(memory_order_relaxed);
+	while (nanoseconds > previous && !maxTime.compare_exchange_weak(previous, nanoseconds, memory_order_relaxed));
+}
+
+/**
+ * Perkiraan persentil: batas atas bucket yang memuat persentil tersebut,
+ * tidak melebihi latensi maksimum
+ * @param  p persentil 0-100
+ * @return   nanodetik
+ */
+unsigned long long Histogram::percentile(double p) {
+	unsigned long counts[STATS_BUCKETS];
+	unsigned long total = 0;
+	for (int i = 0; i < STATS_BUCKETS; i++) {
+		counts[i] = buckets[i].load(memory_order_relaxed);
+		total += counts[i];
+	}
+	if (total == 0) {
+		return 0;
+	}
+
+	unsigned long rank = (unsigned long)(p / 100 * total + 0.5);
+	rank = max(rank, 1UL);
+	unsigned long seen = 0;
+	int bucket = STATS_BUCKETS - 1;
+	for (int i = 0; i < STATS_BUCKETS; i++) {
+		seen += counts[i];
+		if (seen >= rank) {
+			bucket = i;
+			break;
+		}
+	}
+	return min((2ULL << bucket) - 1, maxTime.load(memory_order_relaxed));
+}
+
+//////////////////////////////////////
+// Realisasi Kelas Stats            //
+//////////////////////////////////////
+
+/**
+ * Satu baris hasil histogram
+ * @param kind "op" atau "io"
+ * @param name nama operasi
+ */
+static string formatHistogram(const char *kind, const char *name, Histogram &histogram) {
+	unsigned long count = histogram.count.load(memory_order_relaxed);
+	char line[512];
+	snprintf(line, sizeof(line),
+		"%s=%s count=%lu bytes=%llu io_calls=%llu io_per_op=%.2f avg_us=%.1f p50_us=%.1f p99_us=%.1f p999_us=%.1f max_us=%.1f\n",
+		kind, name, count, histogram.bytes.load(memory_order_relaxed), histogram.ioCalls.load(memory_order_relaxed),
+		count ? (double)histogram.ioCalls.load(memory_order_relaxed) / count : 0,
+		count ? histogram.totalTime.load(memory_order_relaxed) / 1e3 / count : 0,
+		histogram.percentile(50) / 1e3, histogram.percentile(99) / 1e3, histogram.percentile(99.9) / 1e3,
+		histogram.maxTime.load(memory_order_relaxed) / 1e3);
+	return line;
+}
+
+/**
+ * Isi file statistik: operasi fuse dan panggilan backend yang pernah
+ * terjadi, lalu counter cache dan journal
+ * @return
+ */
+string Stats::report() {
+	string result;
+	for (int i = 0; i < OP_COUNT; i++) {
+		if (ops[i].count.load(memory_order_relaxed) != 0) {
+			result += formatHistogram("op", opNames[i], ops[i]);
+		}
+	}
+	for (int i = 0; i < IO_COUNT; i++) {
+		if (io[i].count.load(memory_order_relaxed) != 0) {
+			result += formatHistogram("io", ioNames[i], io[i]);
+		}
+	}
+
+	char line[512];
+	snprintf(line, sizeof(line), "dentry hits=%lu negative=%lu misses=%lu evictions=%lu\n",
+		filesystem.dentry.hits, filesystem.dentry.negativeHits,
+		filesystem.dentry.misses, filesystem.dentry.evictions);
+	result += line;
+	snprintf(line, sizeof(line), "cache hits=%lu misses=%lu evictions=%lu writebacks=%lu dirty_bytes=%lu\n",
+		filesystem.cache.hits, filesystem.cache.misses, filesystem.cache.evictions,
+		filesystem.cache.writebacks, (unsigned long)filesystem.cache.dirtyBytes);
+	result += line;
+	snprintf(line, sizeof(line), "readahead prefetched=%lu hits=%lu wasted=%lu\n",
+		filesystem.cache.prefetched, filesystem.cache.readaheadHits, filesystem.cache.readaheadWasted);
+	result += line;
+	snprintf(line, sizeof(line), "metadata writes=%lu\n", filesystem.metadataWrites);
+	result += line;
+	snprintf(line, sizeof(line), "journal commits=%lu overflows=%lu replays=%lu\n",
+		filesystem.journal.commits, filesystem.journal.overflows, filesystem.journal.replays);
+	result += line;
+	result += filesystem.defrag.report();
+	return result;
+}
+
+/**
+ * Jam monotonic dalam nanodetik
+ */
+unsigned long long Stats::now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+//////////////////////////////////////
+// Realisasi Kelas StatTimer        //
+//////////////////////////////////////
+
+/**
+ * Konstruktor, mulai mengukur
+ * @param histogram tujuan pencatatan
+ */
+StatTimer::StatTimer(Histogram &histogram) : bytes(0), histogram(histogram) {
+	calls = Stats::ioCalls;
+	start = Stats::now();
+}
+
+/**
+ * Destruktor, mencatat latensi
+ */
+StatTimer::~StatTimer() {
+	histogram.record(Stats::now() - start, bytes, Stats::ioCalls - calls);
+}
@@ -0,0 +1,403 @@
+///////////////////////////////////
+// File storage.cpp              //
+// Backend akses file .poi       //
+///////////////////////////////////
+
+#include <stdexcept>		// c++ exception
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include "poi.hpp"
+
+/* Global filesystem */
+extern POI filesystem;
+
+//////////////////////////////////////
+// Realisasi Kelas Storage          //
+//////////////////////////////////////
+
+/**
+ * Membaca banyak potongan, bawaan satu per satu
+ * @param requests posisi, buffer dan ukuran setiap potongan
+ */
+void Storage::readBatch(vector<IORequest> &requests) {
+	for (size_t i = 0; i < requests.size(); i++) {
+		read(requests[i].position, requests[i].buffer, requests[i].size);
+	}
+}
+
+/**
+ * Menulis banyak potongan, bawaan satu per satu
+ * @param requests posisi, buffer dan ukuran setiap potongan
+ */
+void Storage::writeBatch(vector<IORequest> &requests) {
+	for (size_t i = 0; i < requests.size(); i++) {
+		write(requests[i].position, requests[i].buffer, requests[i].size);
+	}
+}
+
+/**
+ * Mengisi nol sebagian file volume. Hole di file volume (sparse) dipakai
+ * jika didukung filesystem host, selain itu ditulis nol biasa.
+ * @param position posisi byte
+ * @param size     jumlah byte
+ */
+void Storage::zero(off_t position, off_t size) {
+	{
+		StatTimer timer(filesystem.stats.io[IO_WRITE]);
+		Stats::ioCalls++;
+		if (fallocate(descriptor(), FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, position, size) == 0) {
+			return;
+		}
+	}
+
+	vector<char> buffer(min(size, (off_t)ZERO_CHUNK), 0);
+	while (size > 0) {
+		size_t size_now = min(size, (off_t)buffer.size());
+		write(position, &buffer[0], size_now);
+		position += size_now;
+		size -= size_now;
+	}
+}
+
+//////////////////////////////////////
+// Realisasi Kelas StreamStorage    //
+//////////////////////////////////////
+
+/**
+ * Konstruktor, membuka file untuk baca-tulis
+ * @param filename nama file
+ */
+StreamStorage::StreamStorage(const char *filename) {
+	fd = open(filename, O_RDWR);
+
+	/* cek apakah file ada */
+	if (fd < 0) {
+		throw runtime_error("File tidak ditemukan");
+	}
+}
+
+/**
+ * Destruktor
+ */
+StreamStorage::~StreamStorage() {
+	::close(fd);
+}
+
+void StreamStorage::read(off_t position, char *buffer, size_t size) {
+	StatTimer timer(filesystem.stats.io[IO_READ]);
+	timer.bytes = size;
+	Stats::ioCalls++;
+	/* pread bisa mengembalikan kurang dari yang diminta (dibatasi 0x7ffff000
+	   byte oleh Linux), sisanya dibaca ulang */
+	while (size > 0) {
+		ssize_t result = pread(fd, buffer, size, position);
+		if (result < 0 && errno == EINTR) {
+			continue;
+		}
+		if (result <= 0) {
+			throw runtime_error("Pembacaan di luar volume");
+		}
+		buffer += result;
+		position += result;
+		size -= result;
+	}
+}
+
+void StreamStorage::write(off_t position, const char *buffer, size_t size) {
+	StatTimer timer(filesystem.stats.io[IO_WRITE]);
+	timer.bytes = size;
+	Stats::ioCalls++;
+	while (size > 0) {
+		ssize_t result = pwrite(fd, buffer, size, position);
+		if (result < 0 && errno == EINTR) {
+			continue;
+		}
+		if (result <= 0) {
+			throw runtime_error("Penulisan volume gagal");
+		}
+		buffer += result;
+		position += result;
+		size -= result;
+	}
+}
+
+void StreamStorage::sync() {
+	StatTimer timer(filesystem.stats.io[IO_SYNC]);
+	Stats::ioCalls++;
+	fsync(fd);
+}
+
+off_t StreamStorage::size() {
+	struct stat stbuf;
+	fstat(fd, &stbuf);
+	return stbuf.st_size;
+}
+
+int StreamStorage::descriptor() {
+	return fd;
+}
+
+//////////////////////////////////////
+// Realisasi Kelas UringStorage     //
+//////////////////////////////////////
+
+/**
+ * Konstruktor, membuka file lalu menyiapkan io_uring
+ * @param filename nama file
+ * @param depth    jumlah permintaan yang berjalan bersamaan
+ */
+UringStorage::UringStorage(const char *filename, unsigned int depth) : StreamStorage(filename) {
+	ring = -1;
+	sqRing = cqRing = NULL;
+	sqes = NULL;
+	if (!setup(depth) && ring >= 0) {
+		::close(ring);
+		ring = -1;
+	}
+}
+
+/**
+ * Destruktor
+ */
+UringStorage::~UringStorage() {
+	if (ring >= 0) {
+		munmap(sqes, sqesSize);
+		if (cqRing != sqRing) {
+			munmap(cqRing, cqRingSize);
+		}
+		munmap(sqRing, sqRingSize);
+		::close(ring);
+	}
+}
+
+/**
+ * Apakah batch dikirim melalui io_uring
+ */
+bool UringStorage::available() {
+	return ring >= 0;
+}
+
+void UringStorage::readBatch(vector<IORequest> &requests) {
+	if (ring < 0 || requests.size() < 2) {
+		Storage::readBatch(requests);
+		return;
+	}
+	submit(requests, IORING_OP_READ);
+}
+
+void UringStorage::writeBatch(vector<IORequest> &requests) {
+	if (ring < 0 || requests.size() < 2) {
+		Storage::writeBatch(requests);
+		return;
+	}
+	submit(requests, IORING_OP_WRITE);
+}
+
+/**
+ * Membuat io_uring dan memetakan ring-nya
+ * @param  depth jumlah entry submission queue
+ * @return       false jika kernel tidak mendukung atau menolak io_uring
+ */
+bool UringStorage::setup(unsigned int depth) {
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	ring = syscall(__NR_io_uring_setup, max(depth, 1u), &params);
+	if (ring < 0) {
+		return false;
+	}
+	entries = params.sq_entries;
+
+	/* ring dipetakan sekali (kernel 5.4), lalu IORING_OP_READ/WRITE
+	   (kernel 5.6) diperiksa lewat probe, yang juga baru ada sejak 5.6;
+	   kernel lebih lama memakai pread/pwrite */
+	if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+		return false;
+	}
+	vector<char> buffer(sizeof(struct io_uring_probe) + IORING_OP_LAST * sizeof(struct io_uring_probe_op), 0);
+	struct io_uring_probe *probe = (struct io_uring_probe*)&buffer[0];
+	if (syscall(__NR_io_uring_register, ring, IORING_REGISTER_PROBE, probe, IORING_OP_LAST) < 0
+		|| probe->last_op < IORING_OP_WRITE
+		|| !(probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED)
+		|| !(probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED)) {
+		return false;
+	}
+	sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+	cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	sqRingSize = cqRingSize = max(sqRingSize, cqRingSize);
+	sqRing = (char*)mmap(NULL, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQ_RING);
+	if (sqRing == MAP_FAILED) {
+		return false;
+	}
+	cqRing = sqRing;
+
+	sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+	sqes = (io_uring_sqe*)mmap(NULL, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQES);
+	if (sqes == MAP_FAILED) {
+		munmap(sqRing, sqRingSize);
+		return false;
+	}
+
+	sqHead = (unsigned int*)(sqRing + params.sq_off.head);
+	sqTail = (unsigned int*)(sqRing + params.sq_off.tail);
+	sqMask = (unsigned int*)(sqRing + params.sq_off.ring_mask);
+	sqArray = (unsigned int*)(sqRing + params.sq_off.array);
+	cqHead = (unsigned int*)(cqRing + params.cq_off.head);
+	cqTail = (unsigned int*)(cqRing + params.cq_off.tail);
+	cqMask = (unsigned int*)(cqRing + params.cq_off.ring_mask);
+	cqes = (io_uring_cqe*)(cqRing + params.cq_off.cqes);
+	return true;
+}
+
+/**
+ * Mengirim semua permintaan, paling banyak entries yang berjalan
+ * bersamaan, dan menunggu semuanya selesai. Baca/tulis yang hanya
+ * sebagian dikirim ulang untuk sisanya.
+ * @param requests potongan yang dibaca/ditulis
+ * @param opcode   IORING_OP_READ atau IORING_OP_WRITE
+ */
+void UringStorage::submit(vector<IORequest> &requests, int opcode) {
+	MutexGuard guard(lock);
+	StatTimer timer(filesystem.stats.io[IO_SUBMIT]);
+	vector<size_t> done(requests.size(), 0);
+	vector<size_t> queue;
+	for (size_t i = requests.size(); i > 0; i--) {
+		queue.push_back(i - 1);
+	}
+
+	unsigned int inflight = 0;
+	unsigned int unsubmitted = 0;
+	while (!queue.empty() || inflight > 0) {
+		/* isi submission queue */
+		unsigned int tail = *sqTail;
+		unsigned int queued = 0;
+		while (!queue.empty() && inflight + queued < entries) {
+			size_t i = queue.back();
+			queue.pop_back();
+			unsigned int index = tail & *sqMask;
+			struct io_uring_sqe *sqe = &sqes[index];
+			memset(sqe, 0, sizeof(*sqe));
+			sqe->opcode = opcode;
+			sqe->fd = descriptor();
+			sqe->off = requests[i].position + done[i];
+			sqe->addr = (unsigned long long)(uintptr_t)(requests[i].buffer + done[i]);
+			sqe->len = requests[i].size - done[i];
+			sqe->user_data = i;
+			sqArray[index] = index;
+			tail++;
+			queued++;
+		}
+		__atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+		inflight += queued;
+		unsubmitted += queued;
+
+		/* entry yang belum diambil kernel dikirim pada panggilan berikutnya */
+		Stats::ioCalls++;
+		int result = syscall(__NR_io_uring_enter, ring, unsubmitted, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+		if (result < 0 && errno != EINTR) {
+			throw runtime_error(opcode == IORING_OP_READ ? "Pembacaan di luar volume" : "Penulisan volume gagal");
+		}
+		if (result > 0) {
+			unsubmitted -= result;
+		}
+
+		/* ambil semua completion yang sudah ada */
+		unsigned int head = *cqHead;
+		while (head != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+			struct io_uring_cqe *cqe = &cqes[head & *cqMask];
+			size_t i = cqe->user_data;
+			int res = cqe->res;
+			head++;
+			inflight--;
+
+			if (res == -EINTR || res == -EAGAIN) {
+				queue.push_back(i);
+				continue;
+			}
+			if (res <= 0) {
+				__atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+				throw runtime_error(opcode == IORING_OP_READ ? "Pembacaan di luar volume" : "Penulisan volume gagal");
+			}
+			done[i] += res;
+			timer.bytes += res;
+			if (done[i] < requests[i].size) {
+				queue.push_back(i);
+			}
+		}
+		__atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+	}
+}
+
+//////////////////////////////////////
+// Realisasi Kelas MmapStorage      //
+//////////////////////////////////////
+
+/**
+ * Konstruktor, memetakan seluruh file ke memori
+ * @param filename nama file
+ */
+MmapStorage::MmapStorage(const char *filename) {
+	fd = open(filename, O_RDWR);
+	if (fd < 0) {
+		throw runtime_error("File tidak ditemukan");
+	}
+
+	struct stat stbuf;
+	fstat(fd, &stbuf);
+	length = stbuf.st_size;
+
+	base = (char*)mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (base == MAP_FAILED) {
+		::close(fd);
+		throw runtime_error("File tidak dapat dipetakan ke memori");
+	}
+}
+
+/**
+ * Destruktor
+ */
+MmapStorage::~MmapStorage() {
+	munmap(base, length);
+	::close(fd);
+}
+
+void MmapStorage::read(off_t position, char *buffer, size_t size) {
+	if ((size_t)position + size > length) {
+		throw runtime_error("Pembacaan di luar volume");
+	}
+	memcpy(buffer, base + position, size);
+}
+
+void MmapStorage::write(off_t position, const char *buffer, size_t size) {
+	if ((size_t)position + size > length) {
+		throw runtime_error("Penulisan di luar volume");
+	}
+	memcpy(base + position, buffer, size);
+}
+
+void MmapStorage::sync() {
+	StatTimer timer(filesystem.stats.io[IO_SYNC]);
+	Stats::ioCalls++;
+	msync(base, length, MS_SYNC);
+}
+
+off_t MmapStorage::size() {
+	return length;
+}
+
+int MmapStorage::descriptor() {
+	return fd;
+}
+
+/**
+ * Pointer langsung ke isi volume
+ * @param  position posisi byte
+ * @return
+ */
+char *MmapStorage::pointer(off_t position) {
+	return base + position;
+}